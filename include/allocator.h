@@ -0,0 +1,176 @@
+//              __     __                            _      __  _                     _
+//              \ \   / /___   __ _   __ _  ___     / \    / _|| |_  ___  _ __  __ _ | |  ___ __      __
+//               \ \ / // _ \ / _` | / _` |/ __|   / _ \  | |_ | __|/ _ \| '__|/ _` || | / _ \\ \ /\ / /
+//                \ V /|  __/| (_| || (_| |\__ \  / ___ \ |  _|| |_|  __/| |  | (_| || || (_) |\ V  V /
+//                 \_/  \___| \__, | \__,_||___/ /_/   \_\|_|   \__|\___||_|   \__, ||_| \___/  \_/\_/
+//                            |___/                                            |___/
+
+#ifndef _ALLOCATOR_
+#define _ALLOCATOR_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "parallel.h"
+
+#if defined(TRANSPARENT_HUGE_PAGES) && defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#ifndef GRID_ALIGNMENT
+#define GRID_ALIGNMENT 64
+#endif
+
+/********************************************************************************************************************
+ * CLASS: FirstTouchScope
+ * DESCRIPTION: While an object of this class is alive, large grids allocated by the current thread with
+ *              GridAllocator are value-initialized in parallel on the given pool, with the static partition of
+ *              parallelForShells over shell_num (phi, theta) shells. The first touch of a page maps it to the NUMA
+ *              node of the touching thread, and every static loop over the shells (parallelForShells and
+ *              parallelForCells with the default policy) hands the same shells to the same worker, so those loops
+ *              read and write node-local memory. The grid is taken to hold plane_num consecutive planes of
+ *              shell_num equal shells (e.g., [field][phi][theta][t] Shock storage); an allocation that does not split
+ *              that way is touched in equal chunks instead. Scopes nest; without a pool, nothing is done up front and
+ *              the elements are value-initialized serially by construct() as usual.
+ ********************************************************************************************************************/
+class FirstTouchScope {
+   public:
+    struct Partition {
+        ThreadPool* pool{nullptr};
+        size_t shell_num{0};
+        size_t plane_num{1};
+    };
+
+    explicit FirstTouchScope(ThreadPool* pool, size_t shell_num = 0, size_t plane_num = 1) : prev_(current()) {
+        current() = {pool, shell_num, plane_num};
+    }
+    ~FirstTouchScope() { current() = prev_; }
+    FirstTouchScope(FirstTouchScope const&) = delete;
+    FirstTouchScope& operator=(FirstTouchScope const&) = delete;
+
+    // Partition used for first touch by the calling thread (a null pool if none).
+    static Partition& current() {
+        thread_local Partition partition;
+        return partition;
+    }
+
+   private:
+    Partition prev_;
+};
+
+/********************************************************************************************************************
+ * STRUCT: GridAllocator
+ * DESCRIPTION: Allocator of all grids (Array, MeshGrid, MeshGrid3d, SynElectronGrid, SynPhotonGrid, Shock storage).
+ *              Every allocation is aligned to simd_align bytes (64 by default, a cache line and an AVX-512 vector;
+ *              set with -DGRID_ALIGNMENT=<bytes>), so the first element of a grid starts a vector. Allocations of at
+ *              least large_bytes are page aligned; when compiled with -DTRANSPARENT_HUGE_PAGES (Linux), they are
+ *              2 MiB aligned and marked with madvise(MADV_HUGEPAGE) before the first touch, so the kernel can back
+ *              them with huge pages. The allocator does not zero memory: elements are value-initialized by
+ *              construct() when the container asks for it, or up front in parallel by allocate() inside a
+ *              FirstTouchScope, in which case construct() leaves those elements alone. The allocator is stateless:
+ *              any instance can free memory allocated by another.
+ ********************************************************************************************************************/
+template <typename T>
+struct GridAllocator {
+    using value_type = T;
+
+    static constexpr size_t simd_align{GRID_ALIGNMENT};
+    static constexpr size_t large_bytes{size_t(1) << 20};
+#ifdef TRANSPARENT_HUGE_PAGES
+    static constexpr size_t large_align{size_t(2) << 20};
+#else
+    static constexpr size_t large_align{4096};
+#endif
+
+    GridAllocator() = default;
+    template <typename U>
+    GridAllocator(GridAllocator<U> const&) {}
+
+    T* allocate(size_t n) {
+        size_t bytes = n * sizeof(T);
+        initialized() = {nullptr, nullptr};
+        if (bytes < large_bytes) {
+            return static_cast<T*>(::operator new(bytes, std::align_val_t(simd_align)));
+        }
+        bytes = (bytes + large_align - 1) / large_align * large_align;
+        T* p = static_cast<T*>(::operator new(bytes, std::align_val_t(large_align)));
+#if defined(TRANSPARENT_HUGE_PAGES) && defined(__linux__)
+        madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+        FirstTouchScope::Partition const& scope = FirstTouchScope::current();
+        if (scope.pool != nullptr) {
+            firstTouch(p, n, scope);
+            initialized() = {p, p + n};
+        }
+        return p;
+    }
+
+    // Value-initialization, skipped for the elements allocate() has already initialized.
+    template <typename U>
+    void construct(U* p) {
+        if constexpr (std::is_same_v<U, T>) {
+            auto [first, last] = initialized();
+            if (first <= p && p < last) {
+                return;
+            }
+        }
+        ::new (static_cast<void*>(p)) U();
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+
+    void deallocate(T* p, size_t n) {
+        if (initialized().first == p) {
+            initialized() = {nullptr, nullptr};
+        }
+        if (n * sizeof(T) < large_bytes) {
+            ::operator delete(p, std::align_val_t(simd_align));
+        } else {
+            ::operator delete(p, std::align_val_t(large_align));
+        }
+    }
+
+    template <typename U>
+    bool operator==(GridAllocator<U> const&) const {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(GridAllocator<U> const&) const {
+        return false;
+    }
+
+   private:
+    // Elements of the last allocation of the calling thread that allocate() has value-initialized.
+    static std::pair<T*, T*>& initialized() {
+        thread_local std::pair<T*, T*> range{nullptr, nullptr};
+        return range;
+    }
+
+    // Value-initializes the n elements at p on the pool, shell by shell with the static shell partition.
+    static void firstTouch(T* p, size_t n, FirstTouchScope::Partition const& scope) {
+        auto init = [](T* first, T* last) {
+            for (; first != last; ++first) {
+                ::new (static_cast<void*>(first)) T();
+            }
+        };
+        size_t row_num = scope.shell_num * scope.plane_num;
+        if (row_num == 0 || n % row_num != 0) {
+            parallelForChunks(scope.pool, 0, n, [p, &init](size_t first, size_t last) { init(p + first, p + last); });
+            return;
+        }
+        size_t row = n / row_num;             // Elements of one shell in one plane
+        size_t plane = n / scope.plane_num;  // Elements of one plane
+        parallelForChunks(scope.pool, 0, scope.shell_num, [&](size_t first, size_t last) {
+            for (size_t f = 0; f < scope.plane_num; ++f) {
+                init(p + f * plane + first * row, p + f * plane + last * row);
+            }
+        });
+    }
+};
+
+#endif
@@ -7,6 +7,7 @@
 
 #ifndef _INVERSECOMPTON_
 #define _INVERSECOMPTON_
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <vector>
@@ -55,19 +56,28 @@ inline Real comptonSigma(Real nu) {
  *              and then determines center values (x and y) from those bins.
  ********************************************************************************************************************/
 struct IntegratorGrid {
+    // Default constructor: Leaves the grid empty, to be set up later with setBoundary() (e.g., for scratch grids).
+    IntegratorGrid() = default;
+
     // Constructor: Initializes the grid with given x and y boundaries.
-    IntegratorGrid(Real x_min, Real x_max, Real y_min, Real y_max)
-        : x_min(x_min), x_max(x_max), y_min(y_min), y_max(y_max) {
+    IntegratorGrid(Real x_min, Real x_max, Real y_min, Real y_max) { setBoundary(x_min, x_max, y_min, y_max); }
+
+    // Recomputes the bins for new x and y boundaries, so that one grid can be reused for many cells.
+    void setBoundary(Real x_min, Real x_max, Real y_min, Real y_max) {
+        this->x_min = x_min;
+        this->x_max = x_max;
+        this->y_min = y_min;
+        this->y_max = y_max;
         logspace(x_min, x_max, x_bin);  // Generate logarithmically spaced bin edges for x.
         logspace(y_min, y_max, y_bin);  // Generate logarithmically spaced bin edges for y.
         boundaryToCenter(x_bin, x);     // Compute center values for x.
         boundaryToCenter(y_bin, y);     // Compute center values for y.
     }
 
-    Real x_min;                                        // Minimum x-value.
-    Real x_max;                                        // Maximum x-value.
-    Real y_min;                                        // Minimum y-value.
-    Real y_max;                                        // Maximum y-value.
+    Real x_min{0};                                     // Minimum x-value.
+    Real x_max{0};                                     // Maximum x-value.
+    Real y_min{0};                                     // Minimum y-value.
+    Real y_max{0};                                     // Maximum y-value.
     static constexpr size_t num{80};                   // Number of bins.
     std::array<Real, num + 1> x_bin{0};                // Bin edges for x.
     std::array<Real, num + 1> y_bin{0};                // Bin edges for y.
@@ -76,23 +86,43 @@ struct IntegratorGrid {
     std::array<Real, num> j_syn{0};                    // Synchrotron intensity at each x center.
     std::array<Real, num> ns{0};                       // Number density at each y center.
     std::array<std::array<Real, num>, num> I0{{{0}}};  // 2D array to store computed intermediate values.
+    static constexpr size_t spectrum_resol{50};        // Number of frequencies of the IC spectrum.
+    std::array<Real, spectrum_resol> nu_IC{0};         // Frequencies of the IC spectrum.
+    std::array<Real, spectrum_resol> j_nu{0};          // IC spectrum integrated at nu_IC.
 };
 
 /********************************************************************************************************************
  * STRUCT: ICPhoton
  * DESCRIPTION: Represents a single inverse Compton (IC) photon.
  *              Contains methods to compute the photon intensity I_nu and to generate an IC photon spectrum based
- *              on electron and synchrotron photon properties.
+ *              on electron and synchrotron photon properties. The spectrum is kept in place as a table of
+ *              log-intensities on a log-uniform frequency grid, so an ICPhoton never allocates and a grid of them is
+ *              one contiguous [cell][spectrum_resol] block. A lookup is a subtraction, a floor and a linear
+ *              interpolation in log space (plus an exp for I_nu).
  ********************************************************************************************************************/
 struct ICPhoton {
    public:
     ICPhoton() = default;
 
     // Resolution of the computed IC spectrum.
-    static constexpr size_t spectrum_resol{50};
+    static constexpr size_t spectrum_resol{IntegratorGrid::spectrum_resol};
 
     // Returns the photon intensity at frequency nu.
-    Real I_nu(Real nu) const;
+    Real I_nu(Real nu) const { return fastExp(log_I_nu(fastLog(nu))); }
+
+    // Returns the log intensity at log_nu = log(nu): log-log interpolation between the two nearest tabulated
+    // frequencies, extrapolated from the outermost pair beyond the table. Zero intensities give -inf.
+    Real log_I_nu(Real log_nu) const {
+        Real t = (log_nu - log_nu_min_) * inv_dlog_nu_;
+        size_t idx = static_cast<size_t>(std::min(Real(spectrum_resol - 2), std::max(Real(0), t)));  // NaN -> 0
+        Real lo = log_j_nu_[idx];
+        Real hi = log_j_nu_[idx + 1];
+        constexpr Real zero = -std::numeric_limits<Real>::infinity();
+        return (lo == zero || hi == zero) ? zero : lo + (hi - lo) * (t - idx);
+    }
+
+    // Returns the intensity integrated over the band [nu_lo, nu_hi], exact for the log-log interpolated spectrum.
+    Real I_nu_band(Real nu_lo, Real nu_hi) const;
 
     // Generates the IC photon spectrum from the given electron and photon data.
     // This template member function uses the properties of the electrons (e) and synchrotron photons (ph) to:
@@ -100,9 +130,33 @@ struct ICPhoton {
     //   - Define integration limits for the synchrotron frequency (nu0) and electron Lorentz factor (gamma).
     //   - Fill in an IntegratorGrid with computed synchrotron intensity and electron column density.
     //   - Compute a 2D array I0 representing differential contributions.
-    //   - Finally, integrate over the grid to populate the IC photon spectrum (j_nu_).
+    //   - Finally, integrate over the grid to populate the IC photon spectrum (log_j_nu_).
     template <typename Electrons, typename Photons>
     void gen(Electrons const& e, Photons const& ph) {
+        IntegratorGrid grid;
+        gen(e, ph, grid);
+    }
+
+    // Same as above, but uses the caller-provided scratch grid instead of constructing one (the grid's contents are
+    // overwritten). Parallel callers keep one scratch grid per thread.
+    template <typename Electrons, typename Photons>
+    void gen(Electrons const& e, Photons const& ph, IntegratorGrid& grid) {
+        fillGrid(e, ph, grid);
+        integrate(grid);
+    }
+
+    // Reference version of gen() that sums every (nu0, gamma) cell of the grid for every IC frequency, in
+    // O(spectrum_resol * num^2). gen() reproduces it to rounding (see benchICSpectrum in tests/benchmark).
+    template <typename Electrons, typename Photons>
+    void genBruteForce(Electrons const& e, Photons const& ph, IntegratorGrid& grid) {
+        fillGrid(e, ph, grid);
+        integrateBruteForce(grid);
+    }
+
+   private:
+    // Sets up the integration grid, its differential contributions I0 and the IC frequency grid, and zeroes grid.j_nu.
+    template <typename Electrons, typename Photons>
+    void fillGrid(Electrons const& e, Photons const& ph, IntegratorGrid& grid) {
         // Real gamma_e_min = min(e.gamma_m, e.gamma_c, e.gamma_a);
         Real nu_ph_min = min(ph.nu_m, ph.nu_c, ph.nu_a);
 
@@ -112,8 +166,8 @@ struct ICPhoton {
         Real gamma_min = std::min(std::min(e.gamma_m, e.gamma_c), e.gamma_a);
         Real gamma_max = e.gamma_M * 10;
 
-        // Construct an integration grid in nu0 and gamma.
-        IntegratorGrid grid(nu0_min, nu0_max, gamma_min, gamma_max);
+        // Set up the integration grid in nu0 and gamma.
+        grid.setBoundary(nu0_min, nu0_max, gamma_min, gamma_max);
 
         // For each bin in nu0, compute the synchrotron intensity.
         for (size_t i = 0; i < grid.num; i++) {
@@ -138,41 +192,46 @@ struct ICPhoton {
         Real nu_min = 4 * gamma_min * gamma_min * nu0_min;
         Real nu_max = 4 * gamma_max * gamma_max * nu0_max;
 
-        // Generate the IC frequency grid and allocate the output array.
-        nu_IC_ = logspace(nu_min, nu_max, spectrum_resol);
-        j_nu_ = Array(boost::extents[spectrum_resol]);
-
-        // Integrate over the grid to compute the final IC photon spectrum.
-        for (size_t k = 0; k < nu_IC_.size(); ++k) {
-            for (size_t i = 0; i < grid.num; ++i) {
-                Real nu0_ = grid.x[i];
-                for (size_t j = 0; j < grid.num; ++j) {
-                    Real gamma_ = grid.y[j];
-                    if (nu0_ <= nu_IC_[k] && nu_IC_[k] <= 4 * gamma_ * gamma_ * nu0_ * IC_x0) {
-                        j_nu_[k] += grid.I0[i][j] * nu_IC_[k];
-                    }
-                }
-            }
-        }
-    };
+        // Generate the IC frequency grid and clear the spectrum.
+        logspace(nu_min, nu_max, grid.nu_IC);
+        std::fill(grid.j_nu.begin(), grid.j_nu.end(), 0);
+    }
 
-   private:
-    Array j_nu_;   // IC photon spectrum intensity array.
-    Array nu_IC_;  // Frequency grid for the IC photon spectrum.
+    // Integrates I0 over the grid into grid.j_nu with cumulative sums (overwrites grid.I0) and stores the spectrum.
+    void integrate(IntegratorGrid& grid);
+
+    // Integrates I0 over the grid into grid.j_nu by summing every grid cell for every IC frequency and stores the
+    // spectrum.
+    void integrateBruteForce(IntegratorGrid& grid);
+
+    // Stores the spectrum grid.j_nu at grid.nu_IC as the log table below.
+    void storeSpectrum(IntegratorGrid const& grid);
+
+    std::array<Real, spectrum_resol> log_j_nu_{};  // Log IC intensity at the tabulated frequencies.
+    Real log_nu_min_{0};                           // Log of the lowest tabulated frequency.
+    Real inv_dlog_nu_{0};                          // Inverse log spacing of the tabulated frequencies.
 };
 
 /********************************************************************************************************************
  * TYPE ALIAS: ICPhotonGrid
- * DESCRIPTION: Defines a 3D grid (using boost::multi_array) for storing ICPhoton objects.
+ * DESCRIPTION: Defines a 3D grid (using boost::multi_array) for storing ICPhoton objects. Since ICPhoton holds its
+ *              spectrum in place, the spectra of all cells share one aligned allocation.
  ********************************************************************************************************************/
-using ICPhotonGrid = boost::multi_array<ICPhoton, 3>;
+using ICPhotonGrid = boost::multi_array<ICPhoton, 3, GridAllocator<ICPhoton>>;
 
 /********************************************************************************************************************
  * FUNCTION PROTOTYPES: IC Photon and Electron Cooling Functions
  * DESCRIPTION: These functions create and generate IC photon grids, and apply electron cooling mechanisms.
+ *              With a thread pool, the grid cells are processed in parallel; the results match a serial run.
+ *              genICPhotons runs independent cells (see parallelForCells); the cooling functions walk whole shells to
+ *              warm-start their solvers (see parallelForShells).
  ********************************************************************************************************************/
 ICPhotonGrid createICPhotonGrid(size_t phi_size, size_t theta_size, size_t t_size);
-ICPhotonGrid genICPhotons(SynElectronGrid const& electron, SynPhotonGrid const& photon);
-void eCoolingThomson(SynElectronGrid& electron, SynPhotonGrid const& photon, Shock const& shock);
-void eCoolingKleinNishina(SynElectronGrid& electron, SynPhotonGrid const& photon, Shock const& shock);
+ICPhotonGrid genICPhotons(SynElectronGrid const& electron, SynPhotonGrid const& photon, ThreadPool* pool = nullptr);
+void eCoolingThomson(SynElectronGrid& electron, SynPhotonGrid const& photon, Shock const& shock,
+                     ThreadPool* pool = nullptr, SolverStats* stats = nullptr);
+void eCoolingKleinNishina(SynElectronGrid& electron, SynPhotonGrid const& photon, Shock const& shock,
+                          ThreadPool* pool = nullptr, SolverStats* stats = nullptr);
+Real effectiveYThomson(Real B, Real t_com, Real eps_e, Real eps_B, SynElectrons const& electron, Real guess = 0,
+                       size_t* iters = nullptr);
 #endif
\ No newline at end of file
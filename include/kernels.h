@@ -0,0 +1,71 @@
+//              __     __                            _      __  _                     _
+//              \ \   / /___   __ _   __ _  ___     / \    / _|| |_  ___  _ __  __ _ | |  ___ __      __
+//               \ \ / // _ \ / _` | / _` |/ __|   / _ \  | |_ | __|/ _ \| '__|/ _` || | / _ \\ \ /\ / /
+//                \ V /|  __/| (_| || (_| |\__ \  / ___ \ |  _|| |_|  __/| |  | (_| || || (_) |\ V  V /
+//                 \_/  \___| \__, | \__,_||___/ /_/   \_\|_|   \__|\___||_|   \__, ||_| \___/  \_/\_/
+//                            |___/                                            |___/
+
+#ifndef _KERNELS_
+#define _KERNELS_
+
+#include <cmath>
+#include <cstddef>
+
+#include "macros.h"
+
+/********************************************************************************************************************
+ * MACRO: RESTRICT
+ * DESCRIPTION: Promises the compiler that a pointer is the only way its data is accessed inside the function, so the
+ *              elementwise loops below can be vectorized without runtime overlap checks.
+ ********************************************************************************************************************/
+#if defined(__GNUC__) || defined(__clang__)
+#define RESTRICT __restrict__
+#elif defined(_MSC_VER)
+#define RESTRICT __restrict
+#else
+#define RESTRICT
+#endif
+
+/********************************************************************************************************************
+ * FUNCTIONS: Elementwise kernels
+ * DESCRIPTION: Raw-pointer loops for the elementwise passes over contiguous grid rows (flux normalization, partial
+ *              flux reductions, band integration, observer geometry). The arrays must not overlap. Grids allocated
+ *              with GridAllocator start on a GRID_ALIGNMENT boundary, so loops over whole grids begin with full,
+ *              aligned vectors. Every kernel performs the same floating-point operations as the plain loop it
+ *              replaces, so the results are bit-identical.
+ ********************************************************************************************************************/
+
+// y[i] *= a
+inline void scaleKernel(Real* RESTRICT y, size_t n, Real a) {
+    for (size_t i = 0; i < n; ++i) {
+        y[i] *= a;
+    }
+}
+
+// y[i] += x[i]
+inline void addKernel(Real* RESTRICT y, Real const* RESTRICT x, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        y[i] += x[i];
+    }
+}
+
+// y[i] += a * x[i]
+inline void axpyKernel(Real* RESTRICT y, Real const* RESTRICT x, size_t n, Real a) {
+    for (size_t i = 0; i < n; ++i) {
+        y[i] += a * x[i];
+    }
+}
+
+// Doppler factor D = 1 / [Gamma (1 - beta cos_v)] and observed time t_obs = [t + (1 - cos_v) r / c] (1 + z) of a
+// column seen at the angle acos(cos_v) from its velocity, given its Lorentz factor, radius and engine time rows.
+template <typename Out>
+inline void columnGeometryKernel(Out* RESTRICT D, Out* RESTRICT t_obs, Real const* RESTRICT Gamma,
+                                 Real const* RESTRICT r, Real const* RESTRICT t, size_t n, Real cos_v, Real z) {
+    for (size_t k = 0; k < n; ++k) {
+        Real beta = std::sqrt(1 - 1 / (Gamma[k] * Gamma[k]));
+        D[k] = 1 / (Gamma[k] * (1 - beta * cos_v));
+        t_obs[k] = (t[k] + (1 - cos_v) * r[k] / con::c) * (1 + z);
+    }
+}
+
+#endif
@@ -19,6 +19,22 @@ constexpr Real operator"" _r(long double x) { return static_cast<Real>(x); }
 
 // Alternatively, if Real might be float and you want to support integer literals too:
 constexpr Real operator"" _r(unsigned long long x) { return static_cast<Real>(x); }
+
+/********************************************************************************************************************
+ * TYPE: Storage
+ * DESCRIPTION: Element type of the large radiation and observer grids (SynPhotonGrid, Observer::t_obs_grid and
+ *              Observer::doppler). It is Real by default; with -DSINGLE_PRECISION_GRIDS these grids store float,
+ *              halving their memory and bandwidth. All arithmetic, ODE states, flux accumulation, and the con::
+ *              constants stay in Real: values are rounded to Storage only when they are written into a grid. The
+ *              Shock fields stay in Real, since the dynamics and the electron distribution depend on Gamma_rel - 1
+ *              down to con::Gamma_cut - 1 = 1e-6, which float cannot resolve.
+ ********************************************************************************************************************/
+#ifdef SINGLE_PRECISION_GRIDS
+using Storage = float;
+#else
+using Storage = Real;
+#endif
+
 namespace con {
     constexpr double len = 1.5e13;
     // Length unit: 1 cm is defined as 1 / len (arbitrary unit conversion)
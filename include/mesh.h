@@ -13,16 +13,23 @@
 #include <functional>
 #include <vector>
 
+#include "allocator.h"
 #include "macros.h"
+#include "view.h"
 /********************************************************************************************************************
  * CONDITIONAL TYPE DEFINITIONS
  * DESCRIPTION: If STATIC_ARRAY is defined, fixed sizes (PHI_SIZE, THETA_SIZE, R_SIZE) are used and specific
  *              array types (Array2D, Array3D) are employed. Otherwise, generic boost::multi_array types are used.
  ********************************************************************************************************************/
 
-using Array = boost::multi_array<Real, 1>;
-using MeshGrid = boost::multi_array<Real, 2>;
-using MeshGrid3d = boost::multi_array<Real, 3>;
+using Array = boost::multi_array<Real, 1, GridAllocator<Real>>;     // All grids are GRID_ALIGNMENT aligned
+using MeshGrid = boost::multi_array<Real, 2, GridAllocator<Real>>;
+template <typename T>
+using Grid3d = boost::multi_array<T, 3, GridAllocator<T>>;  // Large grids: parallel first touch
+using MeshGrid3d = Grid3d<Real>;
+using StorageGrid3d = Grid3d<Storage>;          // Grids of radiation and observer quantities (see Storage)
+using RowView = View<Real const, 1>;            // Read-only (possibly strided) grid row
+using StorageRowView = View<Storage const, 1>;  // Read-only row of a Storage grid
 
 /********************************************************************************************************************
  * FUNCTION TYPE DEFINITIONS
@@ -41,7 +48,8 @@ using TernaryFunc = std::function<Real(Real, Real, Real)>;
  *              - Generating arrays of zeros and ones,
  *              - Finding the minimum and maximum of grids,
  *              - Checking if an array is linearly or logarithmically scaled,
- *              - Creating 2D and 3D grids.
+ *              - Creating 2D and 3D grids (3D grids are first touched and filled on the pool, if one is given),
+ *                including zeroed grids of Storage elements.
  ********************************************************************************************************************/
 Array boundaryToCenter(Array const& boundary);
 Array boundaryToCenterLog(Array const& boundary);
@@ -56,8 +64,9 @@ bool isLinearScale(Array const& arr, Real tolerance = 1e-6);
 bool isLogScale(Array const& arr, Real tolerance = 1e-6);
 MeshGrid createGrid(size_t theta_size, size_t t_size, Real val = 0);
 MeshGrid createGridLike(MeshGrid const& grid, Real val = 0);
-MeshGrid3d create3DGrid(size_t phi_size, size_t theta_size, size_t t_size, Real val = 0);
-MeshGrid3d create3DGridLike(MeshGrid3d const& grid, Real val = 0);
+MeshGrid3d create3DGrid(size_t phi_size, size_t theta_size, size_t t_size, Real val = 0, ThreadPool* pool = nullptr);
+MeshGrid3d create3DGridLike(MeshGrid3d const& grid, Real val = 0, ThreadPool* pool = nullptr);
+StorageGrid3d createStorage3DGrid(size_t phi_size, size_t theta_size, size_t t_size, ThreadPool* pool = nullptr);
 
 /********************************************************************************************************************
  * CLASS: Coord
@@ -102,14 +111,15 @@ Real max(MeshGrid const&... grids) {
  ********************************************************************************************************************/
 template <typename Arr>
 void linspace(Real start, Real end, Arr& result) {
-    size_t num = result.size();
+    auto out = view(result);
+    size_t num = out.size();
     // Handle empty array case.
     Real step = (end - start) / (num - 1);
     if (num == 1) {
         step = 0;
     }
     for (size_t i = 0; i < num; i++) {
-        result[i] = start + i * step;
+        out[i] = start + i * step;
     }
 }
 
@@ -119,7 +129,8 @@ void linspace(Real start, Real end, Arr& result) {
  ********************************************************************************************************************/
 template <typename Arr>
 void logspace(Real start, Real end, Arr& result) {
-    size_t num = result.size();
+    auto out = view(result);
+    size_t num = out.size();
     Real log_start = std::log(start);
     Real log_end = std::log(end);
 
@@ -128,7 +139,7 @@ void logspace(Real start, Real end, Arr& result) {
         step = 0;
     }  // Handle empty array case.
     for (size_t i = 0; i < num; i++) {
-        result[i] = std::exp(log_start + i * step);
+        out[i] = std::exp(log_start + i * step);
     }
 }
 
@@ -138,8 +149,10 @@ void logspace(Real start, Real end, Arr& result) {
  ********************************************************************************************************************/
 template <typename Arr1, typename Arr2>
 void boundaryToCenter(Arr1 const& boundary, Arr2& center) {
-    for (size_t i = 0; i < center.size(); ++i) {
-        center[i] = 0.5 * (boundary[i] + boundary[i + 1]);
+    auto b = view(boundary);
+    auto c = view(center);
+    for (size_t i = 0; i < c.size(); ++i) {
+        c[i] = 0.5 * (b[i] + b[i + 1]);
     }
 }
 
@@ -149,8 +162,10 @@ void boundaryToCenter(Arr1 const& boundary, Arr2& center) {
  ********************************************************************************************************************/
 template <typename Arr1, typename Arr2>
 void boundaryToCenterLog(Arr1 const& boundary, Arr2& center) {
-    for (size_t i = 0; i < center.size(); ++i) {
-        center[i] = std::sqrt(boundary[i] * boundary[i + 1]);
+    auto b = view(boundary);
+    auto c = view(center);
+    for (size_t i = 0; i < c.size(); ++i) {
+        c[i] = std::sqrt(b[i] * b[i + 1]);
     }
 }
 #endif
\ No newline at end of file
@@ -8,14 +8,18 @@
 #ifndef _OBSERVER_
 #define _OBSERVER_
 
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 #include <thread>
+#include <utility>
 #include <vector>
 
 #include "afterglow.h"
+#include "kernels.h"
 #include "macros.h"
 #include "mesh.h"
+#include "parallel.h"
 
 /********************************************************************************************************************
  * CLASS: LogScaleInterp
@@ -32,11 +36,21 @@ class LogScaleInterp {
     // Interpolates the radius, Intensity, and Doppler factor using  the observation time (t)
     std::tuple<Real, Real, Real> interpRID(Real t_obs) const;
 
-    // Tries to set the interpolation boundaries using the provided logarithmic radius array, observation time grid,
-    // Doppler grid, observed frequency, and one or more photon grids.
+    // Adds the interpolated flux contribution D^3 I r^2 times solid_angle at the observation times with logarithms
+    // log_t_obs[first, last) to f_nu[first, last), in one vectorizable pass.
+    void addFluxRun(Real* f_nu, Real const* log_t_obs, size_t first, size_t last, Real solid_angle) const;
+
+    // Adds solid_angle exp(log_F_lo + slope (log_t_obs - log_t_lo)) at log_t_obs[first, last) to f_nu[first, last):
+    // the kernel of addFluxRun, shared with SpectrumInterp.
+    static void addLogLinearRun(Real* f_nu, Real const* log_t_obs, size_t first, size_t last, Real log_F_lo,
+                                Real slope, Real log_t_lo, Real solid_angle);
+
+    // Tries to set the interpolation boundaries of the (i, j) column between k and k + 1 using the column's radius,
+    // observation time and Doppler factor rows, the observed frequency, and one or more photon grids. The rows may be
+    // strided (e.g., the radius row of a Shock field in any ShockLayout).
     template <typename... PhotonGrid>
-    bool trySetBoundary(size_t i, size_t j, size_t k, MeshGrid3d const& r, MeshGrid3d const& t_obs,
-                        MeshGrid3d const& doppler, Real nu_obs, PhotonGrid const&... photons);
+    bool trySetBoundary(size_t i, size_t j, size_t k, RowView r, StorageRowView t_obs, StorageRowView doppler,
+                        Real nu_obs, PhotonGrid const&... photons);
 
    private:
     Real log_r_ratio{0};  // Ratio of logarithmic radius
@@ -44,35 +58,126 @@ class LogScaleInterp {
     Real log_d_ratio{0};  // Ratio of logarithmic Doppler factor
     Real log_I_ratio{0};  // Ratio of logarithmic intensity
 
-    Real I_lo{0};      // Lower boundary of intensity
-    Real t_obs_lo{0};  // Lower boundary of observation time
-    Real r_lo{0};      // Lower boundary of radius
-    Real d_lo{0};      // Lower boundary of Doppler factor
+    Real log_I_lo{0};  // Lower boundary of logarithmic intensity
+    Real log_t_lo{0};  // Lower boundary of logarithmic observation time
+    Real log_r_lo{0};  // Lower boundary of logarithmic radius
+    Real log_d_lo{0};  // Lower boundary of logarithmic Doppler factor
 
-    Real I_hi{0};  // Upper boundary of intensity
+    Real log_I_hi{0};  // Upper boundary of logarithmic intensity
+    Real log_t_hi{0};  // Upper boundary of logarithmic observation time
+    Real log_r_hi{0};  // Upper boundary of logarithmic radius
+    Real log_d_hi{0};  // Upper boundary of logarithmic Doppler factor
 
     size_t idx_hi{0};  // Index for the upper boundary in the grid
+
+    // Logarithmic comoving intensity of cell (i, j, k), summed over the photon grids, seen with Doppler factor D
+    template <typename... PhotonGrid>
+    Real logIntensity(size_t i, size_t j, size_t k, Real D, Real nu_obs, PhotonGrid const&... photons) const;
+};
+
+/********************************************************************************************************************
+ * CLASS: SpectrumInterp
+ * DESCRIPTION: Multi-frequency counterpart of LogScaleInterp for a fixed set of observed frequencies. The radius,
+ *              observation time and Doppler factor boundaries of a segment do not depend on the frequency, so they
+ *              are set once per segment and shared by all frequencies; only the intensity boundaries are kept per
+ *              frequency, and the spectrum of a cell is evaluated for all frequencies at once. A frequency whose
+ *              intensity boundary fails is retired for the rest of the column: LogScaleInterp's walk over a column
+ *              never gets past a failed boundary either (the observation times increase along the column), so both
+ *              give identical fluxes.
+ ********************************************************************************************************************/
+class SpectrumInterp {
+   public:
+    // Takes the redshift and jet dimensionality from interp and the observed frequencies from nu_obs.
+    SpectrumInterp(LogScaleInterp const& interp, Array const& nu_obs);
+
+    // Number of frequencies that have not been retired in the current column.
+    size_t activeCount() const { return active_num; }
+
+    // Starts a new column with all frequencies active.
+    void startColumn();
+
+    // Sets the boundaries of the (i, j) column between k and k + 1 for all active frequencies (see
+    // LogScaleInterp::trySetBoundary), retiring the frequencies whose intensity boundary fails. Returns false if no
+    // frequency is left.
+    template <typename... PhotonGrid>
+    bool trySetBoundary(size_t i, size_t j, size_t k, RowView r, StorageRowView t_obs, StorageRowView doppler,
+                        PhotonGrid const&... photons);
+
+    // Adds the flux contribution of the run log_t_obs[first, last) to every active frequency's row of f_nu; row l
+    // starts at f_nu + l * stride.
+    void addFluxRun(Real* f_nu, size_t stride, Real const* log_t_obs, size_t first, size_t last,
+                    Real solid_angle) const;
+
+   private:
+    Real z{0};         // Redshift
+    size_t jet_3d{0};  // Flag indicating if the jet is non-axis-symmetric (non-zero if true)
+    size_t nu_num{0};  // Number of observed frequencies
+
+    std::vector<Real> nu_z;      // Observed frequencies times (1 + z)
+    std::vector<Real> nu;        // Comoving frequencies of the cell being evaluated
+    std::vector<Real> log_nu;    // Their logarithms
+    std::vector<Real> log_I_lo;  // Lower boundaries of logarithmic intensity, per frequency
+    std::vector<Real> log_I_hi;  // Upper boundaries of logarithmic intensity, per frequency
+    std::vector<char> active;  // Whether each frequency is still interpolated in the current column
+    size_t active_num{0};      // Number of active frequencies
+
+    Real log_t_ratio{0};  // Ratio of logarithmic observation time
+    Real log_r_ratio{0};  // Ratio of logarithmic radius
+    Real log_d_ratio{0};  // Ratio of logarithmic Doppler factor
+
+    Real log_t_lo{0};  // Lower boundary of logarithmic observation time
+    Real log_r_lo{0};  // Lower boundary of logarithmic radius
+    Real log_d_lo{0};  // Lower boundary of logarithmic Doppler factor
+
+    Real log_t_hi{0};  // Upper boundary of logarithmic observation time
+    Real log_r_hi{0};  // Upper boundary of logarithmic radius
+    Real log_d_hi{0};  // Upper boundary of logarithmic Doppler factor
+
+    size_t idx_hi{0};  // Index for the upper boundary in the grid
+
+    // Logarithmic comoving intensities of cell (i, j, k) at all observed frequencies into log_I
+    template <typename... PhotonGrid>
+    void logIntensities(size_t i, size_t j, size_t k, Real D, Real* log_I, PhotonGrid const&... photons);
 };
 
+/********************************************************************************************************************
+ * ENUM: ObserverMode
+ * DESCRIPTION: How the Observer provides the Doppler factor and observation time of the grid cells:
+ *                - Materialized: t_obs_grid and doppler hold them for every (phi, theta, t) cell (the default). They
+ *                  are computed once per viewing angle and cost two phi x theta x t grids (2 x 16 MiB of doubles at
+ *                  128^3);
+ *                - OnTheFly: t_obs_grid and doppler stay empty. The flux integration computes the two t rows of each
+ *                  (phi, theta) column right before integrating it, into a per-thread buffer of 2 x t values.
+ *              Both modes give identical fluxes. OnTheFly recomputes the column geometry in every flux call (once
+ *              for all frequencies of a multi-frequency call), which made the flux integration about 5-15% slower
+ *              in the benchmark (benchObserverMode), while construction and changeViewingAngle become almost free.
+ *              Prefer it when memory is tight (large grids, many observers alive at once); Materialized is faster
+ *              when repeated flux calls share one viewing angle.
+ ********************************************************************************************************************/
+enum class ObserverMode { Materialized, OnTheFly };
+
 /********************************************************************************************************************
  * CLASS: Observer
  * DESCRIPTION: Represents an observer in the shock simulation. The Observer stores observation grids (for
  *              observation time and Doppler factors), as well as parameters such as the observation angle,
  *              luminosity distance, and redshift. It provides methods for "observing" the simulation dynamics
- *              and for computing the specific flux, integrated flux, and spectrum.
+ *              and for computing the specific flux, integrated flux, and spectrum. If a thread pool is attached,
+ *              the flux integration is distributed over its threads.
  ********************************************************************************************************************/
 class Observer {
    public:
     // Constructor: Requires a coordinate reference to initialize the observer.
     template <typename Dynamics>
-    Observer(Coord const& coord, Dynamics const& dyn, Real theta_view, Real luminosity_dist, Real redshift);
+    Observer(Coord const& coord, Dynamics const& dyn, Real theta_view, Real luminosity_dist, Real redshift,
+             ThreadPool* pool = nullptr, ObserverMode mode = ObserverMode::Materialized);
     Observer() = delete;  // Default constructor is deleted.
 
-    MeshGrid3d t_obs_grid;  // Grid of observation times
-    MeshGrid3d doppler;     // Grid of Doppler factors
-    Real theta_obs{0};      // Observer's theta angle
-    Real lumi_dist{1};      // Luminosity distance
-    Real z{0};              // Redshift
+    StorageGrid3d t_obs_grid;    // Grid of observation times (empty in ObserverMode::OnTheFly)
+    StorageGrid3d doppler;       // Grid of Doppler factors (empty in ObserverMode::OnTheFly)
+    Real theta_obs{0};           // Observer's theta angle
+    Real lumi_dist{1};           // Luminosity distance
+    Real z{0};                   // Redshift
+    ThreadPool* pool{nullptr};  // Thread pool for the flux integration (serial if null)
 
     // Observes the provided dynamics (dyn) with the given observation parameters.
     void changeViewingAngle(Real theta_obs);
@@ -90,6 +195,11 @@ class Observer {
     template <typename... PhotonGrid>
     Array flux(Array const& t_obs, Array const& band_freq, PhotonGrid const&... photons);
 
+    // Computes the flux integrated over the band [nu_lo, nu_hi] from the band-integrated cell intensities, in one
+    // pass over the grid.
+    template <typename... PhotonGrid>
+    Array bandFlux(Array const& t_obs, Real nu_lo, Real nu_hi, PhotonGrid const&... photons);
+
     // Computes the spectrum over a frequency band.
     template <typename... PhotonGrid>
     MeshGrid spectrum(Array const& t_obs, Array const& freqs, PhotonGrid const&... photons);
@@ -97,24 +207,133 @@ class Observer {
     template <typename... PhotonGrid>
     MeshGrid spectrum(Real t_obs, Array const& freqs, PhotonGrid const&... photons);
 
+    // Computes the specific flux at nu_obs for every viewing angle in theta_obs, as an [angle][t_obs] grid. The
+    // observer's own viewing angle and grids are left unchanged.
+    template <typename... PhotonGrid>
+    MeshGrid specificFluxVsAngle(Array const& theta_obs, Array const& t_obs, Real nu_obs,
+                                 PhotonGrid const&... photons);
+
+    // Computes the integrated flux over the band band_freq for every viewing angle in theta_obs, as an
+    // [angle][t_obs] grid. The observer's own viewing angle and grids are left unchanged.
+    template <typename... PhotonGrid>
+    MeshGrid fluxVsAngle(Array const& theta_obs, Array const& t_obs, Array const& band_freq,
+                         PhotonGrid const&... photons);
+
    private:
     LogScaleInterp interp;     // Log-scale interpolation helper
     MeshGrid dOmega;           // Grid of solid angles
-    MeshGrid3d const& r_grid;  // Grid of radius
-    MeshGrid3d const& Gamma;   // Grid of Lorentz factors
+    MeshGrid cos_v;            // Cosine of the angle between each column's velocity and the line of sight
+    ShockField const& r_grid;  // Grid of radius
+    ShockField const& Gamma;   // Grid of Lorentz factors
     Coord const& coord;        // Reference to the coordinate object
     size_t eff_phi_size{1};    // Effective number of phi grid points
-
+    ObserverMode mode{ObserverMode::Materialized};
+
+    // Creates the observation time or Doppler factor grid for the given mode (empty if computed on the fly).
+    static StorageGrid3d createGeometryGrid(Coord const& coord, ThreadPool* pool, ObserverMode mode);
+    // Calculates the cosine of the viewing angle of every (phi, theta) column for the current viewing angle.
+    void calcViewCosine();
+    // Calculates the observation time and Doppler factor rows of the (i, j) column, seen at the angle acos(cos_view)
+    // from its velocity (cos_v[i][j] for the current viewing angle).
+    void calcColumnGeometry(size_t i, size_t j, Real cos_view, View<Storage, 1> t_grid, View<Storage, 1> D) const;
     // Calculates the observation time grid based on Gamma and engine time array.
     void calcObsTimeGrid();
     // Calculates the solid angle grid.
     void calcSolidAngle();
 
+    // Number of (phi, theta) cells per partial flux buffer in the flux integration. The blocks depend only on the
+    // grid, so the summation order (and hence the result) does not depend on the number of threads.
+    static constexpr size_t flux_block_size{64};
+    // Number of blocks per thread integrated at a time; bounds the partial buffers to that many per thread.
+    static constexpr size_t flux_wave_blocks{4};
+
+    // Sums the flux of cell_num (phi, theta) cells into the F_size values of F in blocks of flux_block_size cells:
+    // block_flux(first, last, F_b) adds the cells [first, last) to the zeroed partial buffer F_b, and the partial
+    // buffers are added to F in block order, with or without a pool.
+    template <typename BlockFlux>
+    void reduceFluxBlocks(Real* F, size_t F_size, size_t cell_num, BlockFlux&& block_flux) const;
+
     // Template helper method to compute specific flux and store the result in a provided iterator (f_nu).
     template <typename Iter, typename... PhotonGrid>
-    void calcSpecificFlux(Iter f_nu, Array const& t_obs, Real nu_obs, PhotonGrid const&... photons);
+    void calcSpecificFlux(Iter f_nu, Array const& t_obs, Real nu_obs, PhotonGrid const&... photons) const;
+
+    // Accumulates the contribution of the (i, j) cell column, given its solid angle and its radius, observation time
+    // and Doppler factor rows, to the flux array f_nu. log_t_obs holds the logarithms of t_obs.
+    template <typename Iter, typename... PhotonGrid>
+    void calcCellFlux(LogScaleInterp& interp, Iter f_nu, size_t i, size_t j, Real solid_angle, RowView r,
+                      StorageRowView t_grid, StorageRowView D, Array const& t_obs, Array const& log_t_obs,
+                      Real nu_obs, PhotonGrid const&... photons) const;
+
+    // Multi-frequency counterpart of calcSpecificFlux: computes the specific flux at all frequencies in nu_obs into
+    // the [nu][t_obs] rows of F_nu in a single pass over the grid.
+    template <typename... PhotonGrid>
+    void calcSpectrumFlux(Real* F_nu, Array const& t_obs, Array const& nu_obs, PhotonGrid const&... photons) const;
+
+    // Multi-frequency counterpart of calcCellFlux: accumulates the contribution of the (i, j) cell column to the
+    // [nu][t_obs] rows of F_nu, walking the column's time segments once for all frequencies of interp.
+    template <typename... PhotonGrid>
+    void calcColumnSpectrum(SpectrumInterp& interp, Real* F_nu, size_t i, size_t j, Real solid_angle, RowView r,
+                            StorageRowView t_grid, StorageRowView D, Array const& t_obs, Array const& log_t_obs,
+                            PhotonGrid const&... photons) const;
+
+    // Logarithms of the observation times, shared by all columns of a flux calculation.
+    static Array logTimes(Array const& t_obs);
+
+    // Computes the normalized specific flux [angle][nu][t_obs] for several viewing angles at once.
+    template <typename... PhotonGrid>
+    MeshGrid3d calcAngleFlux(Array const& theta_obs, Array const& t_obs, Array const& nu_obs,
+                             PhotonGrid const&... photons) const;
 };
 
+/********************************************************************************************************************
+ * FUNCTION: cellIntensity
+ * DESCRIPTION: Comoving intensity of cell (i, j, k) of a photon grid at frequency nu. Photon grids are either 3D
+ *              arrays of photon objects with an I_nu(nu) method, or (SynPhotonGrid) provide I_nu(i, j, k, nu).
+ ********************************************************************************************************************/
+template <typename PhotonGrid>
+inline Real cellIntensity(PhotonGrid const& photons, size_t i, size_t j, size_t k, Real nu) {
+    return view(photons)(i, j, k).I_nu(nu);
+}
+
+inline Real cellIntensity(SynPhotonGrid const& photons, size_t i, size_t j, size_t k, Real nu) {
+    return photons.I_nu(i, j, k, nu);
+}
+
+/********************************************************************************************************************
+ * FUNCTION: cellLogIntensity
+ * DESCRIPTION: Logarithm of cellIntensity, with log_nu = log(nu). SynPhotonGrid and ICPhotonGrid evaluate their
+ *              log-domain spectra directly, without the exp/log round trip; other photon grids take the log of
+ *              I_nu(nu).
+ ********************************************************************************************************************/
+template <typename PhotonGrid>
+inline Real cellLogIntensity(PhotonGrid const& photons, size_t i, size_t j, size_t k, Real /*log_nu*/, Real nu) {
+    return fastLog(cellIntensity(photons, i, j, k, nu));
+}
+
+inline Real cellLogIntensity(SynPhotonGrid const& photons, size_t i, size_t j, size_t k, Real log_nu, Real nu) {
+    return photons.log_I_nu(i, j, k, log_nu, nu);
+}
+
+inline Real cellLogIntensity(ICPhotonGrid const& photons, size_t i, size_t j, size_t k, Real log_nu, Real /*nu*/) {
+    return photons[i][j][k].log_I_nu(log_nu);
+}
+
+/********************************************************************************************************************
+ * TEMPLATE METHOD: LogScaleInterp::logIntensity
+ * DESCRIPTION: Logarithmic comoving intensity of cell (i, j, k) at the comoving frequency of nu_obs. A single photon
+ *              grid stays in the log domain; several grids are summed in linear space first.
+ ********************************************************************************************************************/
+template <typename... PhotonGrid>
+Real LogScaleInterp::logIntensity(size_t i, size_t j, size_t k, Real D, Real nu_obs,
+                                  PhotonGrid const&... photons) const {
+    Real nu = (1 + z) * nu_obs / D;
+    if constexpr (sizeof...(PhotonGrid) == 1) {
+        return cellLogIntensity(photons..., i, j, k, fastLog(nu), nu);
+    } else {
+        return fastLog((cellIntensity(photons, i, j, k, nu) + ...));
+    }
+}
+
 /********************************************************************************************************************
  * TEMPLATE METHOD: LogScaleInterp::trySetBoundary
  * DESCRIPTION: Attempts to set the lower and upper boundary values for logarithmic interpolation.
@@ -123,39 +342,183 @@ class Observer {
  *                - Logarithmic observation time (log_t_lo, log_t_hi)
  *                - Logarithmic Doppler factor (log_d_lo, log_d_hi)
  *                - Logarithmic intensity (log_I_lo, log_I_hi)
- *              The boundaries are set using data from the provided grids and the photon grids (via parameter pack).
+ *              The boundaries are set using the (i, j) column rows of the radius, observation time and Doppler
+ *              factor, and the photon grids (via parameter pack).
  *              Returns true if both lower and upper log observation time boundaries are finite.
  ********************************************************************************************************************/
 template <typename... PhotonGrid>
-bool LogScaleInterp::trySetBoundary(size_t i, size_t j, size_t k_lo, MeshGrid3d const& r, MeshGrid3d const& t_obs,
-                                    MeshGrid3d const& doppler, Real nu_obs, PhotonGrid const&... photons) {
-    t_obs_lo = t_obs[i][j][k_lo];
-    log_t_ratio = fastLog(t_obs[i][j][k_lo + 1] / t_obs[i][j][k_lo]);
+bool LogScaleInterp::trySetBoundary(size_t i, size_t j, size_t k_lo, RowView r, StorageRowView t_obs,
+                                    StorageRowView doppler, Real nu_obs, PhotonGrid const&... photons) {
+    // If continuing from previous boundary, shift the high boundary values to lower. Evaluating the spectrum is
+    // expensive.
+    if (idx_hi != 0 && k_lo == idx_hi) {
+        log_t_lo = log_t_hi;
+        log_r_lo = log_r_hi;
+        log_d_lo = log_d_hi;
+        log_I_lo = log_I_hi;
+    } else {
+        log_t_lo = fastLog(t_obs[k_lo]);
+        log_r_lo = fastLog(r[k_lo]);
+        log_d_lo = fastLog(doppler[k_lo]);
+        log_I_lo = logIntensity(i * jet_3d, j, k_lo, doppler[k_lo], nu_obs, photons...);
+    }
+    // The upper values are only valid for continuing once the whole boundary is set.
+    idx_hi = 0;
+
+    log_t_hi = fastLog(t_obs[k_lo + 1]);
+    log_t_ratio = log_t_hi - log_t_lo;
 
     if (!std::isfinite(log_t_ratio) || log_t_ratio == 0) {
         return false;
     }
 
-    r_lo = r[i * jet_3d][j][k_lo];
-    log_r_ratio = fastLog(r[i * jet_3d][j][k_lo + 1] / r_lo);
+    log_r_hi = fastLog(r[k_lo + 1]);
+    log_r_ratio = log_r_hi - log_r_lo;
+
+    log_d_hi = fastLog(doppler[k_lo + 1]);
+    log_d_ratio = log_d_hi - log_d_lo;
+
+    log_I_hi = logIntensity(i * jet_3d, j, k_lo + 1, doppler[k_lo + 1], nu_obs, photons...);
+    log_I_ratio = log_I_hi - log_I_lo;
+
+    if (!std::isfinite(log_I_ratio)) {
+        return false;
+    }
+
+    idx_hi = k_lo + 1;
+    return true;
+}
+
+/********************************************************************************************************************
+ * FUNCTION: cellBandIntensity
+ * DESCRIPTION: Comoving intensity of cell (i, j, k) integrated over the band [nu_lo, nu_hi]. Photon grids are either
+ *              3D arrays of photon objects with an I_nu_band(nu_lo, nu_hi) method, or (SynPhotonGrid) provide
+ *              I_nu_band(i, j, k, nu_lo, nu_hi).
+ ********************************************************************************************************************/
+template <typename PhotonGrid>
+inline Real cellBandIntensity(PhotonGrid const& photons, size_t i, size_t j, size_t k, Real nu_lo, Real nu_hi) {
+    return view(photons)(i, j, k).I_nu_band(nu_lo, nu_hi);
+}
+
+inline Real cellBandIntensity(SynPhotonGrid const& photons, size_t i, size_t j, size_t k, Real nu_lo, Real nu_hi) {
+    return photons.I_nu_band(i, j, k, nu_lo, nu_hi);
+}
+
+/********************************************************************************************************************
+ * STRUCT: BandPhotons
+ * DESCRIPTION: Photon grid adaptor used by Observer::bandFlux. Seen at the comoving frequency nu of the lower band
+ *              edge, its intensity is the band-integrated intensity over [nu, nu * ratio] divided by nu. Since
+ *              nu = (1 + z) nu_lo / D, the specific flux of this grid at nu_lo, times nu_lo, is the flux integrated
+ *              over the observed band [nu_lo, ratio * nu_lo]: each cell contributes D^3 I_band D / (1 + z).
+ ********************************************************************************************************************/
+template <typename PhotonGrid>
+struct BandPhotons {
+    PhotonGrid const& photons;  // Photon grid integrated over the band
+    Real ratio{1};              // Ratio of the upper to the lower band edge
+};
+
+template <typename PhotonGrid>
+inline Real cellIntensity(BandPhotons<PhotonGrid> const& band, size_t i, size_t j, size_t k, Real nu) {
+    return cellBandIntensity(band.photons, i, j, k, nu, nu * band.ratio) / nu;
+}
+
+template <typename PhotonGrid>
+inline Real cellLogIntensity(BandPhotons<PhotonGrid> const& band, size_t i, size_t j, size_t k, Real /*log_nu*/,
+                             Real nu) {
+    return fastLog(cellIntensity(band, i, j, k, nu));
+}
+
+/********************************************************************************************************************
+ * FUNCTION: cellLogSpectrum
+ * DESCRIPTION: cellLogIntensity of cell (i, j, k) at n frequencies nu[0, n) with logarithms log_nu[0, n), written to
+ *              log_I[0, n). SynPhotonGrid reads the cell's spectrum once for all frequencies; other photon grids are
+ *              evaluated frequency by frequency.
+ ********************************************************************************************************************/
+template <typename PhotonGrid>
+inline void cellLogSpectrum(PhotonGrid const& photons, size_t i, size_t j, size_t k, Real const* log_nu,
+                            Real const* nu, size_t n, Real* log_I) {
+    for (size_t l = 0; l < n; ++l) {
+        log_I[l] = cellLogIntensity(photons, i, j, k, log_nu[l], nu[l]);
+    }
+}
+
+inline void cellLogSpectrum(SynPhotonGrid const& photons, size_t i, size_t j, size_t k, Real const* log_nu,
+                            Real const* nu, size_t n, Real* log_I) {
+    photons.log_I_nu(i, j, k, log_nu, nu, n, log_I);
+}
 
-    d_lo = doppler[i][j][k_lo];
-    log_d_ratio = fastLog(doppler[i][j][k_lo + 1] / d_lo);
+/********************************************************************************************************************
+ * TEMPLATE METHOD: SpectrumInterp::logIntensities
+ * DESCRIPTION: Logarithmic comoving intensities of cell (i, j, k) at the comoving frequencies of all observed
+ *              frequencies, evaluated as in LogScaleInterp::logIntensity. Retired frequencies are evaluated as well,
+ *              which keeps the loops free of branches; their values are never used.
+ ********************************************************************************************************************/
+template <typename... PhotonGrid>
+void SpectrumInterp::logIntensities(size_t i, size_t j, size_t k, Real D, Real* log_I,
+                                    PhotonGrid const&... photons) {
+    for (size_t l = 0; l < nu_num; ++l) {
+        nu[l] = nu_z[l] / D;
+    }
+    if constexpr (sizeof...(PhotonGrid) == 1) {
+        for (size_t l = 0; l < nu_num; ++l) {
+            log_nu[l] = fastLog(nu[l]);
+        }
+        cellLogSpectrum(photons..., i, j, k, log_nu.data(), nu.data(), nu_num, log_I);
+    } else {
+        for (size_t l = 0; l < nu_num; ++l) {
+            log_I[l] = fastLog((cellIntensity(photons, i, j, k, nu[l]) + ...));
+        }
+    }
+}
 
-    // If continuing from previous boundary, shift the high boundary values to lower. Calling .I_nu() is expensive.
+/********************************************************************************************************************
+ * TEMPLATE METHOD: SpectrumInterp::trySetBoundary
+ * DESCRIPTION: Sets the boundaries between k and k + 1 like LogScaleInterp::trySetBoundary, with the radius,
+ *              observation time and Doppler factor logarithms computed once for all frequencies. A non-finite or
+ *              zero observation time ratio fails every frequency; a non-finite intensity ratio retires only its own
+ *              frequency. Returns true if at least one frequency is left.
+ ********************************************************************************************************************/
+template <typename... PhotonGrid>
+bool SpectrumInterp::trySetBoundary(size_t i, size_t j, size_t k_lo, RowView r, StorageRowView t_obs,
+                                    StorageRowView doppler, PhotonGrid const&... photons) {
+    // If continuing from previous boundary, shift the high boundary values to lower.
     if (idx_hi != 0 && k_lo == idx_hi) {
-        I_lo = I_hi;
+        log_t_lo = log_t_hi;
+        log_r_lo = log_r_hi;
+        log_d_lo = log_d_hi;
+        std::swap(log_I_lo, log_I_hi);
     } else {
-        Real D = doppler[i][j][k_lo];
-        Real nu = (1 + z) * nu_obs / D;
-        I_lo = (photons[i * jet_3d][j][k_lo].I_nu(nu) + ...);
+        log_t_lo = fastLog(t_obs[k_lo]);
+        log_r_lo = fastLog(r[k_lo]);
+        log_d_lo = fastLog(doppler[k_lo]);
+        logIntensities(i * jet_3d, j, k_lo, doppler[k_lo], log_I_lo.data(), photons...);
     }
-    Real D = doppler[i][j][k_lo + 1];
-    Real nu = (1 + z) * nu_obs / D;
-    I_hi = (photons[i * jet_3d][j][k_lo + 1].I_nu(nu) + ...);
-    log_I_ratio = fastLog(I_hi / I_lo);
+    idx_hi = 0;
 
-    if (!std::isfinite(log_I_ratio)) {
+    log_t_hi = fastLog(t_obs[k_lo + 1]);
+    log_t_ratio = log_t_hi - log_t_lo;
+
+    if (!std::isfinite(log_t_ratio) || log_t_ratio == 0) {
+        std::fill(active.begin(), active.end(), 0);
+        active_num = 0;
+        return false;
+    }
+
+    log_r_hi = fastLog(r[k_lo + 1]);
+    log_r_ratio = log_r_hi - log_r_lo;
+
+    log_d_hi = fastLog(doppler[k_lo + 1]);
+    log_d_ratio = log_d_hi - log_d_lo;
+
+    logIntensities(i * jet_3d, j, k_lo + 1, doppler[k_lo + 1], log_I_hi.data(), photons...);
+    for (size_t l = 0; l < nu_num; ++l) {
+        if (active[l] && !std::isfinite(log_I_hi[l] - log_I_lo[l])) {
+            active[l] = 0;
+            active_num--;
+        }
+    }
+
+    if (active_num == 0) {
         return false;
     }
 
@@ -170,18 +533,22 @@ bool LogScaleInterp::trySetBoundary(size_t i, size_t j, size_t k_lo, MeshGrid3d
  *              interpolation object.
  ********************************************************************************************************************/
 template <typename Dynamics>
-Observer::Observer(Coord const& coord, Dynamics const& dyn, Real theta_view, Real luminosity_dist, Real redshift)
-    : t_obs_grid(boost::extents[coord.phi.size()][coord.theta.size()][coord.t.size()]),
-      doppler(boost::extents[coord.phi.size()][coord.theta.size()][coord.t.size()]),
+Observer::Observer(Coord const& coord, Dynamics const& dyn, Real theta_view, Real luminosity_dist, Real redshift,
+                   ThreadPool* pool, ObserverMode mode)
+    : t_obs_grid(createGeometryGrid(coord, pool, mode)),
+      doppler(createGeometryGrid(coord, pool, mode)),
       theta_obs(theta_view),
       lumi_dist(luminosity_dist),
       z(redshift),
+      pool(pool),
       interp(),
       dOmega(boost::extents[coord.phi.size()][coord.theta.size()]),
+      cos_v(boost::extents[coord.phi.size()][coord.theta.size()]),
       r_grid(dyn.r),
       Gamma(dyn.Gamma_rel),
       coord(coord),
-      eff_phi_size(1) {
+      eff_phi_size(1),
+      mode(mode) {
     // Calculate the solid angle grid.
     auto [phi_size, theta_size, t_size] = dyn.shape();
     interp.z = redshift;
@@ -194,75 +561,256 @@ Observer::Observer(Coord const& coord, Dynamics const& dyn, Real theta_view, Rea
     } else {
         eff_phi_size = coord.phi.size();
     }
-    // Calculate the solid angle grid and observation time grid.
+    // Calculate the solid angle and view cosine grids and, unless computed on the fly, the observation time grid.
     calcSolidAngle();
-    calcObsTimeGrid();
+    calcViewCosine();
+    if (mode == ObserverMode::Materialized) {
+        calcObsTimeGrid();
+    }
 }
 
 /********************************************************************************************************************
- * TEMPLATE METHOD: Observer::calcSpecificFlux
- * DESCRIPTION: Calculates the specific flux at each observation time for a given observed frequency nu_obs.
- *              For each effective phi and theta grid point, it:
- *                - Interpolates the Doppler factor, radius, and intensity using the LogScaleInterp object.
- *                - Updates the flux array by accumulating contributions from each grid cell multiplied by its
- *                  solid angle.
- *              Finally, the flux is normalized by the factor (1+z)/(lumi_dist^2).
+ * TEMPLATE METHOD: Observer::calcCellFlux
+ * DESCRIPTION: Accumulates the flux contribution of a single (i, j) grid column into f_nu. For each observation time
+ *              inside the column's observed time span (t_grid) it interpolates the Doppler factor, radius, and
+ *              intensity using the given LogScaleInterp object and adds them multiplied by the column's solid angle.
+ *              The column is described by its rows (r, t_grid, D), so the rows may come from the observer's grids or
+ *              be computed on the fly for another viewing angle.
  ********************************************************************************************************************/
 template <typename Iter, typename... PhotonGrid>
-void Observer::calcSpecificFlux(Iter f_nu, Array const& t_obs, Real nu_obs, const PhotonGrid&... photons) {
-    auto [phi_size, theta_size, t_size] = coord.shape();
+void Observer::calcCellFlux(LogScaleInterp& interp, Iter f_nu, size_t i, size_t j, Real solid_angle, RowView r,
+                            StorageRowView t_grid, StorageRowView D, Array const& t_obs, Array const& log_t_obs,
+                            Real nu_obs, PhotonGrid const&... photons) const {
+    size_t t_size = coord.t.size();
     size_t t_obs_size = t_obs.size();
 
-    // Loop over effective phi and theta grid points.
-    for (size_t i = 0; i < eff_phi_size; i++) {
-        for (size_t j = 0; j < theta_size; j++) {
-            Real const solid_angle = dOmega[i][j];
-            // Attempt to set the initial boundary values; if unsuccessful, skip this grid cell.
-            if (!interp.trySetBoundary(i, j, 0, r_grid, t_obs_grid, doppler, nu_obs, photons...)) {
+    // Attempt to set the initial boundary values; if unsuccessful, skip this grid cell.
+    if (!interp.trySetBoundary(i, j, 0, r, t_grid, D, nu_obs, photons...)) {
+        return;
+    }
+
+    size_t t_idx = 0;
+    // Extrapolation for observation times below the grid (if enabled). Otherwise, skip to the next required
+    // cell untill the first observation time is reached.
+    for (; t_idx < t_obs_size && t_obs[t_idx] < t_grid[0]; t_idx++) {
+#ifdef EXTRAPOLATE
+        auto [r, I_nu, D] = interp.interpRID(t_obs[t_idx]);
+        f_nu[t_idx] += D * D * D * I_nu * r * r * solid_angle;
+#endif
+    }
+
+    // Interpolate for observation times within the grid.
+    for (size_t k = 0; k < t_size - 1 && t_idx < t_obs_size; k++) {
+        Real const t_lo = t_grid[k];
+        Real const t_hi = t_grid[k + 1];
+
+        if (t_lo <= t_obs[t_idx] && t_obs[t_idx] < t_hi) {
+            if (!interp.trySetBoundary(i, j, k, r, t_grid, D, nu_obs, photons...)) {
                 continue;
             }
+        }
 
-            size_t t_idx = 0;
-            // Extrapolation for observation times below the grid (if enabled). Otherwise, skip to the next required
-            // cell untill the first observation time is reached.
-            for (; t_idx < t_obs_size && t_obs[t_idx] < t_obs_grid[i][j][0]; t_idx++) {
+        // All observation times in [t_lo, t_hi) share the boundaries: add them as one run.
+        size_t run_end = t_idx;
+        while (run_end < t_obs_size && t_lo <= t_obs[run_end] && t_obs[run_end] < t_hi) {
+            run_end++;
+        }
+        interp.addFluxRun(&f_nu[0], log_t_obs.data(), t_idx, run_end, solid_angle);
+        t_idx = run_end;
+    }
 #ifdef EXTRAPOLATE
-                auto [r, I_nu, D] = interp.interpRID(t_obs[t_idx]);
-                f_nu[t_idx] += D * D * D * I_nu * r * r * solid_angle;
+    //   Extrapolation for observation times above the grid.
+    for (; t_idx < t_obs_size; t_idx++) {
+        auto [r, I_nu, D] = interp.interpRID(t_obs[t_idx]);
+        f_nu[t_idx] += D * D * D * I_nu * r * r * solid_angle;
+    }
 #endif
-            }
+}
 
-            // Interpolate for observation times within the grid.
-            for (size_t k = 0; k < t_size - 1 && t_idx < t_obs_size; k++) {
-                Real const t_lo = t_obs_grid[i][j][k];
-                Real const t_hi = t_obs_grid[i][j][k + 1];
+/********************************************************************************************************************
+ * TEMPLATE METHOD: Observer::reduceFluxBlocks
+ * DESCRIPTION: Splits the cell_num (phi, theta) cells into blocks of flux_block_size consecutive cells. Every block is
+ *              integrated by block_flux into its own zeroed partial buffer of F_size values, and the partial buffers
+ *              are added to F in block order. The blocks are processed in waves of flux_wave_blocks blocks per
+ *              thread (in parallel with a pool), each wave reduced before the next starts, so the scratch memory is
+ *              bounded by the thread count rather than the number of cells. The blocks and the order of the
+ *              additions depend only on the grid, so the result is the same without a pool and for any number of
+ *              threads.
+ ********************************************************************************************************************/
+template <typename BlockFlux>
+void Observer::reduceFluxBlocks(Real* F, size_t F_size, size_t cell_num, BlockFlux&& block_flux) const {
+    size_t block_num = (cell_num + flux_block_size - 1) / flux_block_size;
+    size_t wave = std::min(block_num, flux_wave_blocks * threadCount(pool));
+    MeshGrid F_block = createGrid(wave, F_size, 0);
+
+    for (size_t b0 = 0; b0 < block_num; b0 += wave) {
+        size_t b1 = std::min(block_num, b0 + wave);
+        parallelFor(pool, b0, b1, [&](size_t b) {
+            Real* F_b = F_block.data() + (b - b0) * F_size;
+            std::fill(F_b, F_b + F_size, 0);
+            block_flux(b * flux_block_size, std::min(cell_num, (b + 1) * flux_block_size), F_b);
+        });
+
+        // Fixed-order reduction of the partial fluxes.
+        for (size_t b = b0; b < b1; ++b) {
+            addKernel(F, F_block.data() + (b - b0) * F_size, F_size);
+        }
+    }
+}
 
-                if (t_lo <= t_obs[t_idx] && t_obs[t_idx] < t_hi) {
-                    if (!interp.trySetBoundary(i, j, k, r_grid, t_obs_grid, doppler, nu_obs, photons...)) {
-                        continue;
-                    }
-                }
+/********************************************************************************************************************
+ * TEMPLATE METHOD: Observer::calcSpecificFlux
+ * DESCRIPTION: Calculates the specific flux at each observation time for a given observed frequency nu_obs by
+ *              accumulating the contributions of all effective phi and theta grid columns (see calcCellFlux).
+ *              The columns are split into fixed blocks of flux_block_size cells; every block is integrated with its
+ *              own LogScaleInterp into its own partial flux buffer, and the partial buffers are then summed in block
+ *              order (see reduceFluxBlocks). The result is therefore identical with or without a pool and for any
+ *              number of threads. Finally, the flux is normalized by the factor (1+z)/(lumi_dist^2).
+ ********************************************************************************************************************/
+template <typename Iter, typename... PhotonGrid>
+void Observer::calcSpecificFlux(Iter f_nu, Array const& t_obs, Real nu_obs, const PhotonGrid&... photons) const {
+    size_t theta_size = coord.theta.size();
+    size_t t_obs_size = t_obs.size();
+    size_t cell_num = eff_phi_size * theta_size;
+
+    size_t t_size = coord.t.size();
+    bool on_the_fly = (mode == ObserverMode::OnTheFly);
+    Array log_t_obs = logTimes(t_obs);
+
+    auto r = view(r_grid);
+    auto t_grid = view(t_obs_grid);
+    auto D = view(doppler);
+    // In OnTheFly mode the column's t_obs and Doppler rows are computed into `rows` ([0, t_size) and [t_size,
+    // 2 t_size)), a buffer owned by the calling thread.
+    auto column_flux = [&](LogScaleInterp& interp_, Real* f, std::vector<Storage>& rows, size_t i, size_t j) {
+        if (on_the_fly) {
+            View<Storage, 1> t_row(rows.data(), {t_size});
+            View<Storage, 1> D_row(rows.data() + t_size, {t_size});
+            calcColumnGeometry(i, j, cos_v[i][j], t_row, D_row);
+            calcCellFlux(interp_, f, i, j, dOmega[i][j], r.row(i * interp.jet_3d, j), t_row, D_row, t_obs,
+                         log_t_obs, nu_obs, photons...);
+        } else {
+            calcCellFlux(interp_, f, i, j, dOmega[i][j], r.row(i * interp.jet_3d, j), t_grid.row(i, j),
+                         D.row(i, j), t_obs, log_t_obs, nu_obs, photons...);
+        }
+    };
 
-                for (; t_idx < t_obs_size && t_lo <= t_obs[t_idx] && t_obs[t_idx] < t_hi; t_idx++) {
-                    auto [r, I_nu, D] = interp.interpRID(t_obs[t_idx]);
-                    f_nu[t_idx] += D * D * D * I_nu * r * r * solid_angle;
-                }
-            }
+    reduceFluxBlocks(&f_nu[0], t_obs_size, cell_num, [&](size_t first, size_t last, Real* f_nu_b) {
+        LogScaleInterp interp_ = interp;
+        std::vector<Storage> rows(on_the_fly ? 2 * t_size : 0);
+        for (size_t cell = first; cell < last; ++cell) {
+            column_flux(interp_, f_nu_b, rows, cell / theta_size, cell % theta_size);
+        }
+    });
+
+    // Normalize the flux by the factor (1+z)/(lumi_dist^2).
+    scaleKernel(&f_nu[0], t_obs_size, (1 + z) / (lumi_dist * lumi_dist));
+}
+
+/********************************************************************************************************************
+ * TEMPLATE METHOD: Observer::calcColumnSpectrum
+ * DESCRIPTION: Accumulates the flux contribution of a single (i, j) grid column at all frequencies of interp into the
+ *              [nu][t_obs] rows of F_nu (t_obs.size() apart). The walk is the one of calcCellFlux, done once for all
+ *              frequencies: the time segments containing observation times, the runs of observation times inside
+ *              them and the radius, time and Doppler factor logarithms are found once, and the spectra of the
+ *              segment ends are evaluated for all frequencies together. Every active frequency then adds the run to
+ *              its own row exactly as calcCellFlux would, so each row is identical to the single-frequency result.
+ ********************************************************************************************************************/
+template <typename... PhotonGrid>
+void Observer::calcColumnSpectrum(SpectrumInterp& interp, Real* F_nu, size_t i, size_t j, Real solid_angle,
+                                  RowView r, StorageRowView t_grid, StorageRowView D, Array const& t_obs,
+                                  Array const& log_t_obs, PhotonGrid const&... photons) const {
+    size_t t_size = coord.t.size();
+    size_t t_obs_size = t_obs.size();
+
+    // Set the initial boundary values; frequencies failing here skip this grid cell.
+    interp.startColumn();
+    if (!interp.trySetBoundary(i, j, 0, r, t_grid, D, photons...)) {
+        return;
+    }
+
+    // Skip to the first observation time inside the grid, or extrapolate below it (if enabled).
+    size_t t_idx = 0;
+    while (t_idx < t_obs_size && t_obs[t_idx] < t_grid[0]) {
+        t_idx++;
+    }
 #ifdef EXTRAPOLATE
-            //   Extrapolation for observation times above the grid.
-            for (; t_idx < t_obs_size; t_idx++) {
-                auto [r, I_nu, D] = interp.interpRID(t_obs[t_idx]);
-                f_nu[t_idx] += D * D * D * I_nu * r * r * solid_angle;
-            }
+    interp.addFluxRun(F_nu, t_obs_size, log_t_obs.data(), 0, t_idx, solid_angle);
 #endif
+
+    // Interpolate for observation times within the grid.
+    for (size_t k = 0; k < t_size - 1 && t_idx < t_obs_size; k++) {
+        Real const t_lo = t_grid[k];
+        Real const t_hi = t_grid[k + 1];
+
+        if (t_lo <= t_obs[t_idx] && t_obs[t_idx] < t_hi) {
+            if (!interp.trySetBoundary(i, j, k, r, t_grid, D, photons...)) {
+                return;  // No frequency left in this column
+            }
+        }
+
+        // All observation times in [t_lo, t_hi) share the boundaries: add them as one run.
+        size_t run_end = t_idx;
+        while (run_end < t_obs_size && t_lo <= t_obs[run_end] && t_obs[run_end] < t_hi) {
+            run_end++;
         }
+        interp.addFluxRun(F_nu, t_obs_size, log_t_obs.data(), t_idx, run_end, solid_angle);
+        t_idx = run_end;
     }
+#ifdef EXTRAPOLATE
+    //   Extrapolation for observation times above the grid.
+    interp.addFluxRun(F_nu, t_obs_size, log_t_obs.data(), t_idx, t_obs_size, solid_angle);
+#endif
+}
+
+/********************************************************************************************************************
+ * TEMPLATE METHOD: Observer::calcSpectrumFlux
+ * DESCRIPTION: Calculates the specific flux at all observed frequencies nu_obs and observation times t_obs into the
+ *              [nu][t_obs] rows of F_nu, walking every effective (phi, theta) column once (see calcColumnSpectrum).
+ *              The columns are summed as in calcSpecificFlux, in fixed blocks of flux_block_size cells with a
+ *              block-order reduction (the partial buffers hold all frequencies). Each row is therefore identical to
+ *              calcSpecificFlux at its frequency. In OnTheFly mode,
+ *              the column geometry is computed once for all frequencies. Finally, the flux is normalized by the
+ *              factor (1+z)/(lumi_dist^2).
+ ********************************************************************************************************************/
+template <typename... PhotonGrid>
+void Observer::calcSpectrumFlux(Real* F_nu, Array const& t_obs, Array const& nu_obs,
+                                PhotonGrid const&... photons) const {
+    size_t theta_size = coord.theta.size();
+    size_t F_size = nu_obs.size() * t_obs.size();
+    size_t cell_num = eff_phi_size * theta_size;
+
+    size_t t_size = coord.t.size();
+    bool on_the_fly = (mode == ObserverMode::OnTheFly);
+    Array log_t_obs = logTimes(t_obs);
+
+    auto r = view(r_grid);
+    auto t_grid = view(t_obs_grid);
+    auto D = view(doppler);
+    // In OnTheFly mode the column's t_obs and Doppler rows are computed into `rows` (see calcSpecificFlux).
+    auto column_flux = [&](SpectrumInterp& interp_, Real* F, std::vector<Storage>& rows, size_t i, size_t j) {
+        if (on_the_fly) {
+            View<Storage, 1> t_row(rows.data(), {t_size});
+            View<Storage, 1> D_row(rows.data() + t_size, {t_size});
+            calcColumnGeometry(i, j, cos_v[i][j], t_row, D_row);
+            calcColumnSpectrum(interp_, F, i, j, dOmega[i][j], r.row(i * interp.jet_3d, j), t_row, D_row, t_obs,
+                               log_t_obs, photons...);
+        } else {
+            calcColumnSpectrum(interp_, F, i, j, dOmega[i][j], r.row(i * interp.jet_3d, j), t_grid.row(i, j),
+                               D.row(i, j), t_obs, log_t_obs, photons...);
+        }
+    };
+
+    reduceFluxBlocks(F_nu, F_size, cell_num, [&](size_t first, size_t last, Real* F_b) {
+        SpectrumInterp interp_(interp, nu_obs);
+        std::vector<Storage> rows(on_the_fly ? 2 * t_size : 0);
+        for (size_t cell = first; cell < last; ++cell) {
+            column_flux(interp_, F_b, rows, cell / theta_size, cell % theta_size);
+        }
+    });
 
     // Normalize the flux by the factor (1+z)/(lumi_dist^2).
-    Real const coef = (1 + z) / (lumi_dist * lumi_dist);
-    for (size_t i = 0; i < t_obs_size; ++i) {
-        f_nu[i] *= coef;
-    }
+    scaleKernel(F_nu, F_size, (1 + z) / (lumi_dist * lumi_dist));
 }
 
 /********************************************************************************************************************
@@ -279,24 +827,24 @@ Array Observer::specificFlux(Array const& t_obs, Real nu_obs, PhotonGrid const&.
 
 /********************************************************************************************************************
  * TEMPLATE METHOD: Observer::specificFlux (multi-frequency overload)
- * DESCRIPTION: Returns the specific flux (as a MeshGrid) for multiple observed frequencies (nu_obs) by computing
- *              the specific flux for each frequency and assembling the results into a grid.
+ * DESCRIPTION: Returns the specific flux (as a MeshGrid) for multiple observed frequencies (nu_obs). All frequencies
+ *              are computed in one pass over the grid (see calcSpectrumFlux): the time segments of every column are
+ *              found once and each cell's spectrum is evaluated for the whole nu_obs vector. With a thread pool, the
+ *              grid cells are distributed over its threads. Every row equals specificFlux at its frequency.
  ********************************************************************************************************************/
 template <typename... PhotonGrid>
 MeshGrid Observer::specificFlux(Array const& t_obs, Array const& nu_obs, PhotonGrid const&... photons) {
     MeshGrid F_nu = createGrid(nu_obs.size(), t_obs.size(), 0);
-    size_t t_num = t_obs.size();
-    for (size_t l = 0; l < nu_obs.size(); ++l) {
-        calcSpecificFlux(F_nu.data() + l * t_num, t_obs, nu_obs[l], photons...);
-    }
+    calcSpectrumFlux(F_nu.data(), t_obs, nu_obs, photons...);
     return F_nu;
 }
 
 /********************************************************************************************************************
  * TEMPLATE METHOD: Observer::flux
  * DESCRIPTION: Computes the integrated flux over a frequency band specified by band_freq.
- *              It converts band boundaries to center frequencies, computes the specific flux at each frequency,
- *              and integrates (sums) the flux contributions weighted by the frequency bin widths.
+ *              It converts band boundaries to center frequencies, computes the specific flux at all of them in one
+ *              pass over the grid, and integrates (sums) the flux contributions weighted by the frequency bin widths.
+ *              For a single band, bandFlux integrates the cell spectra over the band instead of sampling them.
  ********************************************************************************************************************/
 template <typename... PhotonGrid>
 Array Observer::flux(Array const& t_obs, Array const& band_freq, PhotonGrid const&... photons) {
@@ -304,9 +852,140 @@ Array Observer::flux(Array const& t_obs, Array const& band_freq, PhotonGrid cons
     MeshGrid F_nu = specificFlux(t_obs, nu_obs, photons...);
     Array flux = zeros(t_obs.size());
     for (size_t i = 0; i < F_nu.size(); ++i) {
-        Real dnu = band_freq[i + 1] - band_freq[i];
-        for (size_t j = 0; j < flux.size(); ++j) {
-            flux[j] += dnu * F_nu[i][j];
+        axpyKernel(flux.data(), F_nu.data() + i * t_obs.size(), t_obs.size(), band_freq[i + 1] - band_freq[i]);
+    }
+    return flux;
+}
+
+/********************************************************************************************************************
+ * TEMPLATE METHOD: Observer::bandFlux
+ * DESCRIPTION: Computes the flux integrated over the observed band [nu_lo, nu_hi]. Instead of sampling the specific
+ *              flux at sub-band centers as flux() does, every cell contributes its comoving intensity integrated over
+ *              the Doppler-shifted band (cellBandIntensity, in closed form for the broken power-law synchrotron
+ *              spectra), so a band light curve costs a single specificFlux pass (see BandPhotons). The integrated
+ *              intensities are interpolated in time like the specific intensities.
+ ********************************************************************************************************************/
+template <typename... PhotonGrid>
+Array Observer::bandFlux(Array const& t_obs, Real nu_lo, Real nu_hi, PhotonGrid const&... photons) {
+    Array F = zeros(t_obs.size());
+    calcSpecificFlux(F.data(), t_obs, nu_lo, BandPhotons<PhotonGrid>{photons, nu_hi / nu_lo}...);
+    scaleKernel(F.data(), t_obs.size(), nu_lo);
+    return F;
+}
+
+/********************************************************************************************************************
+ * TEMPLATE METHOD: Observer::calcAngleFlux
+ * DESCRIPTION: Computes the normalized specific flux F[angle][nu][t_obs] for all viewing angles in theta_obs and all
+ *              frequencies in nu_obs in one pass over the grid. The view cosine of every (angle, phi, theta) column
+ *              is computed up front, with the trigonometric functions of the angles and grid coordinates evaluated
+ *              once each. The angles are then split into contiguous groups, one per thread. Each group walks the
+ *              (phi, theta) columns once and builds the Doppler factor and observation time rows of every angle in
+ *              the group with calcColumnGeometry, in small row buffers (instead of full 3D grids per angle). The
+ *              photon intensities depend on the Doppler-shifted frequency, so they are still evaluated per angle,
+ *              for all frequencies at once (see calcColumnSpectrum). The columns are summed in the same blocks and
+ *              block order as in specificFlux (see reduceFluxBlocks; the [nu][t_obs] rows of a group's angles are
+ *              contiguous in F_nu), so the result matches changeViewingAngle() followed by specificFlux() for each
+ *              angle.
+ ********************************************************************************************************************/
+template <typename... PhotonGrid>
+MeshGrid3d Observer::calcAngleFlux(Array const& theta_obs, Array const& t_obs, Array const& nu_obs,
+                                   PhotonGrid const&... photons) const {
+    auto [phi_size, theta_size, t_size] = coord.shape();
+    size_t angle_num = theta_obs.size();
+    size_t t_obs_size = t_obs.size();
+    MeshGrid3d F_nu = create3DGrid(angle_num, nu_obs.size(), t_obs_size, 0);
+    Array log_t_obs = logTimes(t_obs);
+
+    // View cosine of every column for every angle, in the same form as calcViewCosine.
+    Array sin_theta = zeros(theta_size);
+    Array cos_theta = zeros(theta_size);
+    for (size_t j = 0; j < theta_size; ++j) {
+        sin_theta[j] = std::sin(coord.theta[j]);
+        cos_theta[j] = std::cos(coord.theta[j]);
+    }
+    MeshGrid3d cos_view = create3DGrid(angle_num, phi_size, theta_size);
+    for (size_t a = 0; a < angle_num; ++a) {
+        Real sin_obs = std::sin(theta_obs[a]);
+        Real cos_obs = std::cos(theta_obs[a]);
+        for (size_t i = 0; i < phi_size; ++i) {
+            Real cos_phi = std::cos(coord.phi[i]);
+            for (size_t j = 0; j < theta_size; ++j) {
+                cos_view[a][i][j] = sin_theta[j] * cos_phi * sin_obs + cos_theta[j] * cos_obs;
+            }
+        }
+    }
+
+    size_t group_num = std::min(angle_num, threadCount(pool));
+
+    parallelFor(pool, 0, group_num, [&](size_t g) {
+        size_t a_begin = g * angle_num / group_num;
+        size_t a_end = (g + 1) * angle_num / group_num;
+        size_t group_size = a_end - a_begin;
+        size_t F_size = nu_obs.size() * t_obs_size;
+
+        // The cell index i * theta_size + j is the one specificFlux uses: for an axisymmetric view (one effective
+        // phi), only the cells with i = 0 contribute.
+        auto block_flux = [&](size_t first, size_t last, Real* F_b) {
+            SpectrumInterp interp_(interp, nu_obs);
+            boost::multi_array<Storage, 2, GridAllocator<Storage>> t_grid(boost::extents[group_size][t_size]);
+            boost::multi_array<Storage, 2, GridAllocator<Storage>> D(boost::extents[group_size][t_size]);
+            for (size_t cell = first; cell < last; ++cell) {
+                size_t i = cell / theta_size;
+                size_t j = cell % theta_size;
+                auto r = view(r_grid).row(i * interp.jet_3d, j);
+                for (size_t a = 0; a < group_size; ++a) {
+                    // Same effective phi size and solid angle as the Observer would use for this viewing angle.
+                    bool axisymmetric = (theta_obs[a_begin + a] == 0 && interp.jet_3d == 0);
+                    if (axisymmetric && i > 0) {
+                        continue;
+                    }
+                    Real solid_angle = coord.dcos[j] * (axisymmetric ? 2 * con::pi : coord.dphi[i]);
+
+                    calcColumnGeometry(i, j, cos_view[a_begin + a][i][j], view(t_grid).row(a), view(D).row(a));
+                    calcColumnSpectrum(interp_, F_b + a * F_size, i, j, solid_angle, r, view(t_grid).row(a),
+                                       view(D).row(a), t_obs, log_t_obs, photons...);
+                }
+            }
+        };
+        reduceFluxBlocks(&F_nu[a_begin][0][0], group_size * F_size, phi_size * theta_size, block_flux);
+    });
+
+    // Normalize the flux by the factor (1+z)/(lumi_dist^2).
+    scaleKernel(F_nu.data(), F_nu.num_elements(), (1 + z) / (lumi_dist * lumi_dist));
+    return F_nu;
+}
+
+/********************************************************************************************************************
+ * TEMPLATE METHOD: Observer::specificFluxVsAngle
+ * DESCRIPTION: Returns the specific flux at nu_obs as an [angle][t_obs] grid for all viewing angles in theta_obs,
+ *              computed in a single pass over the grid (see calcAngleFlux).
+ ********************************************************************************************************************/
+template <typename... PhotonGrid>
+MeshGrid Observer::specificFluxVsAngle(Array const& theta_obs, Array const& t_obs, Real nu_obs,
+                                       PhotonGrid const&... photons) {
+    Array nu(boost::extents[1]);
+    nu[0] = nu_obs;
+    MeshGrid3d F_nu = calcAngleFlux(theta_obs, t_obs, nu, photons...);
+    MeshGrid F = createGrid(theta_obs.size(), t_obs.size(), 0);
+    std::copy(F_nu.data(), F_nu.data() + F_nu.num_elements(), F.data());
+    return F;
+}
+
+/********************************************************************************************************************
+ * TEMPLATE METHOD: Observer::fluxVsAngle
+ * DESCRIPTION: Returns the integrated flux over the band band_freq as an [angle][t_obs] grid for all viewing angles
+ *              in theta_obs. The specific fluxes of all angles and band frequencies are computed in a single pass
+ *              (see calcAngleFlux) and then summed with the frequency bin widths, as in flux().
+ ********************************************************************************************************************/
+template <typename... PhotonGrid>
+MeshGrid Observer::fluxVsAngle(Array const& theta_obs, Array const& t_obs, Array const& band_freq,
+                               PhotonGrid const&... photons) {
+    Array nu_obs = boundaryToCenterLog(band_freq);
+    MeshGrid3d F_nu = calcAngleFlux(theta_obs, t_obs, nu_obs, photons...);
+    MeshGrid flux = createGrid(theta_obs.size(), t_obs.size(), 0);
+    for (size_t a = 0; a < theta_obs.size(); ++a) {
+        for (size_t i = 0; i < nu_obs.size(); ++i) {
+            axpyKernel(&flux[a][0], &F_nu[a][i][0], t_obs.size(), band_freq[i + 1] - band_freq[i]);
         }
     }
     return flux;
@@ -0,0 +1,340 @@
+//              __     __                            _      __  _                     _
+//              \ \   / /___   __ _   __ _  ___     / \    / _|| |_  ___  _ __  __ _ | |  ___ __      __
+//               \ \ / // _ \ / _` | / _` |/ __|   / _ \  | |_ | __|/ _ \| '__|/ _` || | / _ \\ \ /\ / /
+//                \ V /|  __/| (_| || (_| |\__ \  / ___ \ |  _|| |_|  __/| |  | (_| || || (_) |\ V  V /
+//                 \_/  \___| \__, | \__,_||___/ /_/   \_\|_|   \__|\___||_|   \__, ||_| \___/  \_/\_/
+//                            |___/                                            |___/
+
+#ifndef _PARALLEL_
+#define _PARALLEL_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <numeric>
+#include <vector>
+
+#include "BS_thread_pool.hpp"
+#include "macros.h"
+
+/********************************************************************************************************************
+ * TYPE ALIAS: ThreadPool
+ * DESCRIPTION: Thread pool used by the parallel code paths. A pointer to a pool is passed to the functions that
+ *              support parallel execution; a null pointer (the default everywhere) selects the serial code path.
+ ********************************************************************************************************************/
+using ThreadPool = BS::thread_pool<>;
+
+/********************************************************************************************************************
+ * INLINE FUNCTION: onPoolThread
+ * DESCRIPTION: Returns true if the calling thread is one of the workers of the given pool. Used to fall back to
+ *              serial execution for nested parallel loops, which would otherwise deadlock waiting on their own pool.
+ ********************************************************************************************************************/
+inline bool onPoolThread(ThreadPool const* pool) {
+    auto owner = BS::this_thread::get_pool();
+    return owner.has_value() && *owner == static_cast<void const*>(pool);
+}
+
+/********************************************************************************************************************
+ * INLINE FUNCTION: threadCount
+ * DESCRIPTION: Returns the number of threads that a parallel loop on the given pool can use (1 for serial runs).
+ ********************************************************************************************************************/
+inline size_t threadCount(ThreadPool const* pool) {
+    if (pool == nullptr || onPoolThread(pool)) {
+        return 1;
+    }
+    return std::max<size_t>(pool->get_thread_count(), 1);
+}
+
+/********************************************************************************************************************
+ * TEMPLATE FUNCTION: parallelFor
+ * DESCRIPTION: Calls func(idx) for every idx in [begin, end). With a pool, the range is split into one contiguous
+ *              block per thread and the call blocks until every index is done; any exception thrown by func is
+ *              rethrown in the calling thread after all blocks have finished. Without a pool (or when called from
+ *              inside the pool) the loop runs serially in index order.
+ ********************************************************************************************************************/
+template <typename Func>
+void parallelFor(ThreadPool* pool, size_t begin, size_t end, Func&& func) {
+    if (threadCount(pool) == 1 || end - begin <= 1) {
+        for (size_t idx = begin; idx < end; ++idx) {
+            func(idx);
+        }
+        return;
+    }
+    auto futures = pool->submit_loop(begin, end, [&func](size_t idx) { func(idx); });
+    futures.wait();  // Make sure no block still references func before an exception unwinds the caller.
+    futures.get();
+}
+
+/********************************************************************************************************************
+ * ENUM CLASS: Schedule
+ * DESCRIPTION: How parallelForChunks distributes the index range over the threads.
+ *                - Static:  the range is cut into fixed chunks up front, and chunk c is run by pool worker
+ *                           c % threads, so static loops over the same range give the same indices to the same
+ *                           thread (the partition the grids are first touched with, see FirstTouchScope). Only if
+ *                           a worker is still busy elsewhere when another has finished its own chunks does the
+ *                           idle worker take over the busy worker's chunks.
+ *                - Dynamic: one task per thread, each repeatedly claiming the next chunk from a shared counter.
+ *                           Better for cells of very uneven cost.
+ ********************************************************************************************************************/
+enum class Schedule { Static, Dynamic };
+
+/********************************************************************************************************************
+ * STRUCT: LoopPolicy
+ * DESCRIPTION: Schedule and chunk size (in indices) of a parallel loop. A chunk size of 0 lets the loop choose: one
+ *              chunk per thread for Static, and about eight chunks per thread for Dynamic.
+ ********************************************************************************************************************/
+struct LoopPolicy {
+    Schedule schedule{Schedule::Static};
+    size_t chunk{0};
+};
+
+/********************************************************************************************************************
+ * TEMPLATE FUNCTION: parallelForChunks
+ * DESCRIPTION: Calls func(first, last) for contiguous chunks [first, last) covering [begin, end), distributed over
+ *              the pool according to the policy. Blocks until all chunks are done and rethrows any exception from
+ *              func. Without a pool (or when called from inside the pool) the whole range is one serial chunk.
+ ********************************************************************************************************************/
+template <typename Func>
+void parallelForChunks(ThreadPool* pool, size_t begin, size_t end, Func&& func, LoopPolicy policy = {}) {
+    if (end <= begin) {
+        return;
+    }
+    size_t threads = threadCount(pool);
+    size_t total = end - begin;
+    if (threads == 1 || total == 1) {
+        func(begin, end);
+        return;
+    }
+
+    if (policy.schedule == Schedule::Static) {
+        size_t chunk_num = std::min(policy.chunk == 0 ? threads : (total + policy.chunk - 1) / policy.chunk, total);
+        // One task per worker; each runs the chunks of its own worker index, or of the first worker whose chunks
+        // are still unclaimed if a worker picked up more than one task.
+        std::vector<std::atomic<bool>> claimed(threads);
+        auto futures = pool->submit_sequence(0, threads, [&](size_t) {
+            size_t home = BS::this_thread::get_index().value_or(0) % threads;
+            for (size_t w = home; w < home + threads; ++w) {
+                if (!claimed[w % threads].exchange(true)) {
+                    for (size_t c = w % threads; c < chunk_num; c += threads) {
+                        func(begin + c * total / chunk_num, begin + (c + 1) * total / chunk_num);
+                    }
+                    return;
+                }
+            }
+        });
+        futures.wait();  // Make sure no block still references func before an exception unwinds the caller.
+        futures.get();
+    } else {
+        size_t chunk = policy.chunk == 0 ? std::max<size_t>(total / (8 * threads), 1) : policy.chunk;
+        std::atomic<size_t> next{begin};
+        auto futures = pool->submit_sequence(0, threads, [&](size_t) {
+            for (size_t first = next.fetch_add(chunk); first < end; first = next.fetch_add(chunk)) {
+                func(first, std::min(first + chunk, end));
+            }
+        });
+        futures.wait();
+        futures.get();
+    }
+}
+
+/********************************************************************************************************************
+ * TEMPLATE FUNCTION: parallelForCells
+ * DESCRIPTION: Calls func(i, j, k) for every cell of a (phi_size x theta_size x t_size) grid, where the cells are
+ *              independent of each other. The cells are visited in row-major order within each chunk, so chunks
+ *              map onto contiguous memory of the grids. The chunk size of the policy is counted in cells.
+ *              This is the executor for per-cell stages (e.g., the radiation grids): a new stage only has to
+ *              supply the cell body.
+ ********************************************************************************************************************/
+template <typename Func>
+void parallelForCells(ThreadPool* pool, size_t phi_size, size_t theta_size, size_t t_size, Func&& func,
+                      LoopPolicy policy = {}) {
+    if (theta_size == 0 || t_size == 0) {
+        return;
+    }
+    parallelForChunks(
+        pool, 0, phi_size * theta_size * t_size,
+        [&func, theta_size, t_size](size_t first, size_t last) {
+            size_t k = first % t_size;
+            size_t j = (first / t_size) % theta_size;
+            size_t i = first / (t_size * theta_size);
+            for (size_t cell = first; cell < last; ++cell) {
+                func(i, j, k);
+                if (++k == t_size) {
+                    k = 0;
+                    if (++j == theta_size) {
+                        j = 0;
+                        ++i;
+                    }
+                }
+            }
+        },
+        policy);
+}
+
+/********************************************************************************************************************
+ * TEMPLATE FUNCTION: parallelForShells
+ * DESCRIPTION: Calls func(i, j) for every (phi, theta) shell of a (phi_size x theta_size) grid; the body walks the
+ *              t cells of its shell itself. This is the executor for per-cell stages that carry state from one cell
+ *              to the next along t (e.g., the warm starts of the electron solvers): every shell is walked by a
+ *              single thread from k = 0, so the result does not depend on how the shells are distributed. The chunk
+ *              size of the policy is counted in shells.
+ ********************************************************************************************************************/
+template <typename Func>
+void parallelForShells(ThreadPool* pool, size_t phi_size, size_t theta_size, Func&& func, LoopPolicy policy = {}) {
+    if (theta_size == 0) {
+        return;
+    }
+    parallelForChunks(
+        pool, 0, phi_size * theta_size,
+        [&func, theta_size](size_t first, size_t last) {
+            for (size_t shell = first; shell < last; ++shell) {
+                func(shell / theta_size, shell % theta_size);
+            }
+        },
+        policy);
+}
+
+/********************************************************************************************************************
+ * STRUCT: SchedulerStats
+ * DESCRIPTION: Load-balance report of a parallelForWeighted call: for each worker, the wall-clock time spent inside
+ *              the loop body (busy time), the number of items it ran, and how many of them it stole from other
+ *              workers. A balanced run has nearly equal busy times.
+ ********************************************************************************************************************/
+struct SchedulerStats {
+    std::vector<double> busy_time;  // Seconds spent in the loop body, per worker
+    std::vector<size_t> items;      // Items run, per worker
+    std::vector<size_t> stolen;     // Items taken from another worker's queue, per worker
+
+    // Ratio of the maximum to the mean busy time (1 is perfect balance).
+    double imbalance() const {
+        if (busy_time.empty()) {
+            return 1;
+        }
+        double total = std::accumulate(busy_time.begin(), busy_time.end(), 0.0);
+        double max = *std::max_element(busy_time.begin(), busy_time.end());
+        return total > 0 ? max * busy_time.size() / total : 1;
+    }
+};
+
+/********************************************************************************************************************
+ * TEMPLATE FUNCTION: parallelForWeighted
+ * DESCRIPTION: Calls func(idx) for every idx in [0, cost.size()) on a work-stealing scheduler, for loops whose items
+ *              have very different (but roughly predictable) costs. The items are first dealt to one queue per
+ *              worker, largest estimated cost first, always to the least loaded queue. Each worker then runs its own
+ *              queue from the expensive end and, once it is empty, steals the cheapest remaining items from the
+ *              other queues. The estimate only has to rank the items; stealing corrects any error. If stats is not
+ *              null, it receives the per-worker busy times. Without a pool the items run serially in index order.
+ ********************************************************************************************************************/
+template <typename Func>
+void parallelForWeighted(ThreadPool* pool, std::vector<Real> const& cost, Func&& func,
+                         SchedulerStats* stats = nullptr) {
+    using clock = std::chrono::steady_clock;
+    size_t n = cost.size();
+    size_t workers = std::min(threadCount(pool), std::max<size_t>(n, 1));
+
+    if (stats != nullptr) {
+        stats->busy_time.assign(workers, 0);
+        stats->items.assign(workers, 0);
+        stats->stolen.assign(workers, 0);
+    }
+
+    auto run = [&](size_t w, size_t idx) {
+        auto start = clock::now();
+        func(idx);
+        if (stats != nullptr) {
+            stats->busy_time[w] += std::chrono::duration<double>(clock::now() - start).count();
+            stats->items[w]++;
+        }
+    };
+
+    if (workers == 1) {
+        for (size_t idx = 0; idx < n; ++idx) {
+            run(0, idx);
+        }
+        return;
+    }
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<size_t> items;  // Front: most expensive
+    };
+    std::vector<WorkQueue> queues(workers);
+
+    // Longest-processing-time-first seeding.
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return cost[a] > cost[b]; });
+    std::vector<Real> load(workers, 0);
+    for (size_t idx : order) {
+        size_t w = std::min_element(load.begin(), load.end()) - load.begin();
+        queues[w].items.push_back(idx);
+        load[w] += cost[idx];
+    }
+
+    auto futures = pool->submit_sequence(0, workers, [&](size_t w) {
+        while (true) {
+            size_t idx = n;
+            {
+                std::lock_guard<std::mutex> lock(queues[w].mutex);
+                if (!queues[w].items.empty()) {
+                    idx = queues[w].items.front();
+                    queues[w].items.pop_front();
+                }
+            }
+            for (size_t v = 1; idx == n && v < workers; ++v) {
+                WorkQueue& victim = queues[(w + v) % workers];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.items.empty()) {
+                    idx = victim.items.back();
+                    victim.items.pop_back();
+                    if (stats != nullptr) {
+                        stats->stolen[w]++;
+                    }
+                }
+            }
+            if (idx == n) {
+                return;  // Every queue is empty; queues are never refilled.
+            }
+            run(w, idx);
+        }
+    });
+    futures.wait();  // Make sure no worker still references func before an exception unwinds the caller.
+    futures.get();
+}
+
+/********************************************************************************************************************
+ * TEMPLATE CLASS: PerThread
+ * DESCRIPTION: One instance of T per thread that can run the work of a parallel loop on the given pool (every
+ *              worker plus the calling thread). local() returns the instance owned by the calling thread, so loop
+ *              bodies can reuse scratch buffers without locking or reallocating them for every index.
+ ********************************************************************************************************************/
+template <typename T>
+class PerThread {
+   public:
+    explicit PerThread(ThreadPool const* pool)
+        : pool_(pool), slots_(pool == nullptr ? 1 : pool->get_thread_count() + 1) {}
+
+    T& local() {
+        if (pool_ != nullptr && onPoolThread(pool_)) {
+            return slots_[BS::this_thread::get_index().value()];
+        }
+        return slots_.back();
+    }
+
+    // Calls func(instance) for the instance of every thread, e.g., to combine per-thread results after the loop.
+    template <typename Func>
+    void forEach(Func&& func) {
+        for (T& slot : slots_) {
+            func(slot);
+        }
+    }
+
+   private:
+    ThreadPool const* pool_{nullptr};
+    std::vector<T> slots_;
+};
+
+#endif
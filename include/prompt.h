@@ -10,6 +10,7 @@
 
 #include "jet.h"
 #include "mesh.h"
+#include "parallel.h"
 #include "physics.h"
 
 struct PromptPhotons {
@@ -24,7 +25,8 @@ using PromptPhotonsGrid = boost::multi_array<PromptPhotons, 3>;
 PromptPhotonsGrid createPromptPhotonsGrid(size_t phi_size, size_t theta_size, size_t r_size);
 
 template <typename Jet>
-PromptPhotonsGrid genPromptPhotons(Coord const& coord, Jet const& jet, Real R0, Real nu_0, Real alpha) {
+PromptPhotonsGrid genPromptPhotons(Coord const& coord, Jet const& jet, Real R0, Real nu_0, Real alpha,
+                                   ThreadPool* pool = nullptr) {
     auto [phi_size, theta_size, r_size] = coord.shape();
 
     PromptPhotonsGrid ph = createPromptPhotonsGrid(phi_size, theta_size, r_size);
@@ -32,24 +34,28 @@ PromptPhotonsGrid genPromptPhotons(Coord const& coord, Jet const& jet, Real R0,
     Real Gamma_c = jet.Gamma0(0, 0, 0);
     Real beta_c = gammaTobeta(Gamma_c);
 
-    for (size_t i = 0; i < phi_size; ++i) {
-        for (size_t j = 0; j < theta_size; ++j) {
-            Real theta = coord.theta[j];
-            Real Gamma = jet.Gamma0(0, theta, 0);
-            Real beta = gammaTobeta(Gamma);
-            Real R = R0 / (beta_c) * (beta);
-            for (size_t k = 0; k < r_size - 1; ++k) {
-                if (coord.t[k + 1] > R && coord.t[k] < R) {
-                    ph[i][j][k].E_nu_peak = jet.dEdOmega(0, theta, 0) / Gamma;
-
-                } else {
-                    ph[i][j][k].E_nu_peak = 0;
-                }
-                ph[i][j][k].nu_0 = nu_0;
-                ph[i][j][k].alpha = alpha;
-            }
-        }
+    // The emission radius and peak energy only depend on theta.
+    Array R = zeros(theta_size);
+    Array E_peak = zeros(theta_size);
+    for (size_t j = 0; j < theta_size; ++j) {
+        Real theta = coord.theta[j];
+        Real Gamma = jet.Gamma0(0, theta, 0);
+        Real beta = gammaTobeta(Gamma);
+        R[j] = R0 / (beta_c) * (beta);
+        E_peak[j] = jet.dEdOmega(0, theta, 0) / Gamma;
     }
+
+    // The last radial cell is left untouched, as before.
+    parallelForCells(pool, phi_size, theta_size, r_size - 1, [&](size_t i, size_t j, size_t k) {
+        if (coord.t[k + 1] > R[j] && coord.t[k] < R[j]) {
+            ph[i][j][k].E_nu_peak = E_peak[j];
+
+        } else {
+            ph[i][j][k].E_nu_peak = 0;
+        }
+        ph[i][j][k].nu_0 = nu_0;
+        ph[i][j][k].alpha = alpha;
+    });
     return ph;
 }
 
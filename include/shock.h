@@ -9,63 +9,99 @@
 #define _SHOCKDYNAMICS_
 
 #include <tuple>
+#include <vector>
 
 #include "jet.h"
 #include "medium.h"
 #include "mesh.h"
 #include "odeint.hpp"
+#include "parallel.h"
 #include "physics.h"
 
+/********************************************************************************************************************
+ * ENUM: ShockLayout
+ * DESCRIPTION: Memory layout of the Shock fields inside the Shock's single allocation:
+ *                - SoA:   [field][phi][theta][t], every field is a contiguous 3D grid (the default);
+ *                - AoSoA: [phi][theta][field][t], the field rows of each (phi, theta) shell are stored together;
+ *                - AoS:   [phi][theta][t][field], one record with all fields per cell.
+ *              SoA suits passes over a single field, AoS passes that read every field of a cell (the radiation
+ *              passes), and AoSoA keeps each shell's data in one block while leaving the field rows contiguous.
+ ********************************************************************************************************************/
+enum class ShockLayout { SoA, AoSoA, AoS };
+
+using ShockStorage = boost::multi_array<Real, 4, GridAllocator<Real>>;
+using ShockField = ShockStorage::array_view<3>::type;  // Strided (phi, theta, t) view of one field
+
 /********************************************************************************************************************
  * CLASS: Shock
  * DESCRIPTION: Represents a shock structure that stores grid-based data for the shock evolution, including
  *              comoving time, engine time, relative Lorentz factor, magnetic field, and proton column density.
  *              It also stores constant energy fractions (eps_e and eps_B) and provides a method to return
- *              the grid dimensions.
+ *              the grid dimensions. The five fields live in one allocation with the given layout, and are
+ *              accessed through views indexed like a MeshGrid3d (shock.B[i][j][k]).
  ********************************************************************************************************************/
 class Shock {
    public:
-    Shock(size_t phi_size, size_t theta_size, size_t t_size, Real eps_e, Real eps_B);
+    Shock(size_t phi_size, size_t theta_size, size_t t_size, Real eps_e, Real eps_B, ThreadPool* pool = nullptr,
+          ShockLayout layout = ShockLayout::SoA);
+    Shock(Shock const& other);
     Shock() = delete;
 
-    MeshGrid3d t_com;           // comoving time
-    MeshGrid3d r;               // radius
-    MeshGrid3d Gamma_rel;       // relative lorentz factor between down stream and up stream
-    MeshGrid3d B;               // comoving magnetic field
-    MeshGrid3d column_num_den;  // down stream proton column number density
+   private:
+    ShockStorage data;   // All fields; declared before the views that point into it
+    ShockLayout layout;  // Layout of the fields in data
+
+   public:
+    ShockField t_com;           // comoving time
+    ShockField r;               // radius
+    ShockField Gamma_rel;       // relative lorentz factor between down stream and up stream
+    ShockField B;               // comoving magnetic field
+    ShockField column_num_den;  // down stream proton column number density
     Real eps_e{0};              // electron energy fraction
     Real eps_B{0};              // magnetic energy fraction
 
     auto shape() const { return std::make_tuple(phi_size, theta_size, t_size); }  // Returns grid dimensions
+    ShockLayout storageLayout() const { return layout; }                           // Returns the field layout
 
    private:
     size_t const phi_size{0};    // Number of grid points in phi direction
     size_t const theta_size{0};  // Number of grid points in theta direction
     size_t const t_size{0};      // Number of grid points in time direction
+
+    // Returns the view of the field with the given index (0-4, in declaration order) into data.
+    ShockField field(size_t f);
 };
 
 /********************************************************************************************************************
  * FUNCTION PROTOTYPES: Shock Generation Interfaces
  * DESCRIPTION: These function templates declare interfaces to generate forward shocks (2D and 3D) and
- *              forward/reverse shock pairs.
+ *              forward/reverse shock pairs. Passing a thread pool distributes the (phi, theta) shells over its
+ *              threads; every shell only writes its own [i][j] slice, so the result is bit-identical to a serial run.
+ *              The shells are scheduled by parallelForWeighted using the cost estimates below (shells that stop
+ *              immediately are cheap, shells with a reverse shock run two steppers). If stats is not null, it
+ *              receives the per-thread busy times. layout selects the memory layout of the returned shocks.
  ********************************************************************************************************************/
 using ShockPair = std::pair<Shock, Shock>;
 
 template <typename Jet, typename Injector>
 Shock genForwardShock(Coord const& coord, Medium const& medium, Jet const& jet, Injector const& inject, Real eps_e,
-                      Real eps_B, Real rtol = 1e-6);
+                      Real eps_B, Real rtol = 1e-6, ThreadPool* pool = nullptr, SchedulerStats* stats = nullptr,
+                      ShockLayout layout = ShockLayout::SoA);
 
 template <typename Jet, typename Injector>
 Shock genForwardShock3D(Coord const& coord, Medium const& medium, Jet const& jet, Injector const& inject, Real eps_e,
-                        Real eps_B, Real rtol = 1e-6);
+                        Real eps_B, Real rtol = 1e-6, ThreadPool* pool = nullptr, SchedulerStats* stats = nullptr,
+                        ShockLayout layout = ShockLayout::SoA);
 
 template <typename Jet, typename Injector>
 ShockPair genFRShocks(Coord const& coord, Medium const& medium, Jet const& jet, Injector const& inject, Real eps_e,
-                      Real eps_B, Real rtol = 1e-6);
+                      Real eps_B, Real rtol = 1e-6, ThreadPool* pool = nullptr, SchedulerStats* stats = nullptr,
+                      ShockLayout layout = ShockLayout::SoA);
 
 template <typename Jet, typename Injector>
 ShockPair genFRShocks3D(Coord const& coord, Medium const& medium, Jet const& jet, Injector const& inject, Real eps_e,
-                        Real eps_B, Real rtol = 1e-6);
+                        Real eps_B, Real rtol = 1e-6, ThreadPool* pool = nullptr, SchedulerStats* stats = nullptr,
+                        ShockLayout layout = ShockLayout::SoA);
 
 /********************************************************************************************************************
  * INLINE FUNCTIONS: Shock Utilities
@@ -75,6 +111,7 @@ ShockPair genFRShocks3D(Coord const& coord, Medium const& medium, Jet const& jet
  *              velocities, and update the shock state.
  ********************************************************************************************************************/
 
+Real u_DownStrExact(Real gamma_rel, Real sigma);
 Real u_DownStr(Real gamma_rel, Real sigma);
 Real u_UpStr2u_DownStr(Real gamma_rel, Real sigma);
 void updateShockState(Shock& shock, size_t i, size_t j, size_t k, Real r, Real Gamma_rel, Real t_com, Real dNdOmega_up,
@@ -109,6 +146,25 @@ inline void setStoppingShock(size_t i, size_t j, Shock& f_shock, Array const& t,
 }
 //
 
+/********************************************************************************************************************
+ * INLINE FUNCTIONS: Shell Cost Estimates
+ * DESCRIPTION: Relative cost of solving one shell, used to seed the shell scheduler. A shell whose initial Lorentz
+ *              factor is below con::Gamma_cut only fills its arrays (setStoppingShock); a forward shell runs one
+ *              Bulirsch-Stoer stepper; a shell with a reverse shock runs two.
+ ********************************************************************************************************************/
+template <typename Jet>
+inline Real forwardShellCost(Jet const& jet, Real phi, Real theta, Real t0) {
+    return jet.Gamma0(phi, theta, t0) <= con::Gamma_cut ? 0.05 : 1;
+}
+
+template <typename RShockEqn>
+inline Real frShellCost(RShockEqn const& eqn_r, Real t0) {
+    if (!reverseShockExists(eqn_r, t0)) {
+        return forwardShellCost(eqn_r.jet, eqn_r.phi, eqn_r.theta, t0);
+    }
+    return eqn_r.jet.Gamma0(eqn_r.phi, eqn_r.theta, t0) <= con::Gamma_cut ? 0.05 : 2;
+}
+
 template <typename Jet, typename Injector>
 class SimpleShockEqn;
 template <typename Jet, typename Injector>
@@ -124,17 +180,26 @@ class FRShockEqn;
  ********************************************************************************************************************/
 template <typename Jet, typename Injector>
 Shock genForwardShock(Coord const& coord, Medium const& medium, Jet const& jet, Injector const& inject, Real eps_e,
-                      Real eps_B, Real rtol) {
+                      Real eps_B, Real rtol, ThreadPool* pool, SchedulerStats* stats, ShockLayout layout) {
     auto [phi_size, theta_size, t_size] = coord.shape();  // Unpack coordinate dimensions
-    Shock f_shock(1, theta_size, t_size, eps_e, eps_B);   // Create Shock with 1 phi slice
+    Shock f_shock(1, theta_size, t_size, eps_e, eps_B, pool, layout);  // Create Shock with 1 phi slice
+
+    std::vector<Real> cost(theta_size);
     for (size_t j = 0; j < theta_size; ++j) {
-        // Create a ForwardShockEqn for each theta slice (phi is set to 0)
-        // auto eqn = ForwardShockEqn(medium, jet, inject, 0, coord.theta[j], eps_e);
-        auto eqn = SimpleShockEqn(medium, jet, inject, 0, coord.theta[j], eps_e);
-        //           Solve the shock shell for this theta slice
-        solveForwardShell(0, j, coord.t, f_shock, eqn, rtol);
+        cost[j] = forwardShellCost(jet, 0, coord.theta[j], coord.t[0]);
     }
 
+    parallelForWeighted(
+        pool, cost,
+        [&](size_t j) {
+            // Create a ForwardShockEqn for each theta slice (phi is set to 0)
+            // auto eqn = ForwardShockEqn(medium, jet, inject, 0, coord.theta[j], eps_e);
+            auto eqn = SimpleShockEqn(medium, jet, inject, 0, coord.theta[j], eps_e);
+            //           Solve the shock shell for this theta slice
+            solveForwardShell(0, j, coord.t, f_shock, eqn, rtol);
+        },
+        stats);
+
     return f_shock;
 }
 
@@ -145,19 +210,28 @@ Shock genForwardShock(Coord const& coord, Medium const& medium, Jet const& jet,
  ********************************************************************************************************************/
 template <typename Jet, typename Injector>
 Shock genForwardShock3D(Coord const& coord, Medium const& medium, Jet const& jet, Injector const& inject, Real eps_e,
-                        Real eps_B, Real rtol) {
+                        Real eps_B, Real rtol, ThreadPool* pool, SchedulerStats* stats, ShockLayout layout) {
     auto [phi_size, theta_size, t_size] = coord.shape();
 
-    Shock f_shock(phi_size, theta_size, t_size, eps_e, eps_B);  // Create Shock with full 3D dimensions
-    for (size_t i = 0; i < phi_size; ++i) {
-        for (size_t j = 0; j < theta_size; ++j) {
+    Shock f_shock(phi_size, theta_size, t_size, eps_e, eps_B, pool, layout);  // Create Shock with full 3D dimensions
+
+    std::vector<Real> cost(phi_size * theta_size);
+    for (size_t idx = 0; idx < cost.size(); ++idx) {
+        cost[idx] = forwardShellCost(jet, coord.phi[idx / theta_size], coord.theta[idx % theta_size], coord.t[0]);
+    }
+
+    parallelForWeighted(
+        pool, cost,
+        [&](size_t idx) {
+            size_t i = idx / theta_size;
+            size_t j = idx % theta_size;
             // Create a ForwardShockEqn for each (phi, theta) pair
             auto eqn = ForwardShockEqn(medium, jet, inject, coord.phi[i], coord.theta[j], eps_e);
             // auto eqn = SimpleShockEqn(medium, jet, inject, coord.phi[i], coord.theta[j], eps_e);
             //  Solve the shock shell for this (phi, theta) slice
             solveForwardShell(i, j, coord.t, f_shock, eqn, rtol);
-        }
-    }
+        },
+        stats);
     return f_shock;
 }
 
@@ -169,21 +243,29 @@ Shock genForwardShock3D(Coord const& coord, Medium const& medium, Jet const& jet
  ********************************************************************************************************************/
 template <typename Jet, typename Injector>
 ShockPair genFRShocks(Coord const& coord, Medium const& medium, Jet const& jet, Injector const& inject, Real eps_e,
-                      Real eps_B, Real rtol) {
+                      Real eps_B, Real rtol, ThreadPool* pool, SchedulerStats* stats, ShockLayout layout) {
     auto [phi_size, theta_size, t_size] = coord.shape();
 
-    Shock f_shock(1, theta_size, t_size, eps_e, eps_B);  // Forward shock for 1 phi slice
-    Shock r_shock(1, theta_size, t_size, eps_e, eps_B);  // Reverse shock for 1 phi slice
+    Shock f_shock(1, theta_size, t_size, eps_e, eps_B, pool, layout);  // Forward shock for 1 phi slice
+    Shock r_shock(1, theta_size, t_size, eps_e, eps_B, pool, layout);  // Reverse shock for 1 phi slice
 
+    std::vector<Real> cost(theta_size);
     for (size_t j = 0; j < theta_size; ++j) {
-        // Create equations for forward and reverse shocks for each theta slice (phi is 0)
-        auto eqn_f = ForwardShockEqn(medium, jet, inject, 0, coord.theta[j], eps_e);
-        // auto eqn_f = SimpleShockEqn(medium, jet, inject, 0, coord.theta[j], eps_e);
-        auto eqn_r = FRShockEqn(medium, jet, inject, 0, coord.theta[j]);
-        // Solve the forward-reverse shock shell
-        solveFRShell(0, j, coord.t, f_shock, r_shock, eqn_f, eqn_r, rtol);
+        cost[j] = frShellCost(FRShockEqn(medium, jet, inject, 0, coord.theta[j]), coord.t[0]);
     }
 
+    parallelForWeighted(
+        pool, cost,
+        [&](size_t j) {
+            // Create equations for forward and reverse shocks for each theta slice (phi is 0)
+            auto eqn_f = ForwardShockEqn(medium, jet, inject, 0, coord.theta[j], eps_e);
+            // auto eqn_f = SimpleShockEqn(medium, jet, inject, 0, coord.theta[j], eps_e);
+            auto eqn_r = FRShockEqn(medium, jet, inject, 0, coord.theta[j]);
+            // Solve the forward-reverse shock shell
+            solveFRShell(0, j, coord.t, f_shock, r_shock, eqn_f, eqn_r, rtol);
+        },
+        stats);
+
     return std::make_pair(std::move(f_shock), std::move(r_shock));
 }
 
@@ -195,21 +277,31 @@ ShockPair genFRShocks(Coord const& coord, Medium const& medium, Jet const& jet,
  ********************************************************************************************************************/
 template <typename Jet, typename Injector>
 ShockPair genFRShocks3D(Coord const& coord, Medium const& medium, Jet const& jet, Injector const& inject, Real eps_e,
-                        Real eps_B, Real rtol) {
+                        Real eps_B, Real rtol, ThreadPool* pool, SchedulerStats* stats, ShockLayout layout) {
     auto [phi_size, theta_size, t_size] = coord.shape();
 
-    Shock f_shock(phi_size, theta_size, t_size, eps_e, eps_B);  // Forward shock for full 3D dimensions
-    Shock r_shock(phi_size, theta_size, t_size, eps_e, eps_B);  // Reverse shock for full 3D dimensions
-    for (size_t i = 0; i < phi_size; ++i) {
-        for (size_t j = 0; j < theta_size; ++j) {
+    Shock f_shock(phi_size, theta_size, t_size, eps_e, eps_B, pool, layout);  // Forward shock for full 3D dimensions
+    Shock r_shock(phi_size, theta_size, t_size, eps_e, eps_B, pool, layout);  // Reverse shock for full 3D dimensions
+
+    std::vector<Real> cost(phi_size * theta_size);
+    for (size_t idx = 0; idx < cost.size(); ++idx) {
+        auto eqn_r = FRShockEqn(medium, jet, inject, coord.phi[idx / theta_size], coord.theta[idx % theta_size]);
+        cost[idx] = frShellCost(eqn_r, coord.t[0]);
+    }
+
+    parallelForWeighted(
+        pool, cost,
+        [&](size_t idx) {
+            size_t i = idx / theta_size;
+            size_t j = idx % theta_size;
             // Create equations for forward and reverse shocks for each (phi, theta) pair
             auto eqn_f = ForwardShockEqn(medium, jet, inject, coord.phi[i], coord.theta[j], eps_e);
             // auto eqn_f = SimpleShockEqn(medium, jet, inject, coord.phi[i], coord.theta[j], eps_e);
             auto eqn_r = FRShockEqn(medium, jet, inject, coord.phi[i], coord.theta[j]);
             // Solve the forward-reverse shock shell for this (phi, theta) pair
             solveFRShell(i, j, coord.t, f_shock, r_shock, eqn_f, eqn_r, rtol);
-        }
-    }
+        },
+        stats);
     return std::make_pair(std::move(f_shock), std::move(r_shock));
 }
 
@@ -11,6 +11,7 @@
  * INCLUDES
  * DESCRIPTION: Standard and project-specific headers required for synchrotron calculations.
  ********************************************************************************************************************/
+#include <cstdint>
 #include <vector>
 
 #include "medium.h"
@@ -36,8 +37,10 @@ struct InverseComptonY {
     size_t regime{0};     // Indicator for the operating regime
 
     // Member functions
-    Real as_nu(Real nu, Real p) const;        // Computes based on frequency and power-law index
-    Real as_gamma(Real gamma, Real p) const;  // Computes based on Lorentz factor and power-law index
+    Real as_nu(Real nu, Real p) const;              // Computes based on frequency and power-law index
+    Real as_gamma(Real gamma, Real p) const;        // Computes based on Lorentz factor and power-law index
+    Real as_gamma_slope(Real gamma, Real p) const;  // d log(as_gamma) / d log(gamma)
+    Real Y_max(Real p) const;                       // Maximum of as_gamma over all gamma
 
     // Static member functions for combined Y parameters
     static Real Y_Thompson(InverseComptonY const& Ys);
@@ -71,63 +74,164 @@ struct SynElectrons {
     inline Real gammaSpectrum(Real gamma) const;
 };
 
+/********************************************************************************************************************
+ * STRUCT: LogSpectrum
+ * DESCRIPTION: Log-domain piecewise-linear form of a synchrotron spectrum. Between the spectral breaks, log I_nu is a
+ *              straight line in log nu, so segment s is fully described by its log intensity log_I[s] at a reference
+ *              break frequency (intensity peak included) and a slope that only depends on the regime and p. The
+ *              exponential cutoff above nu_M and the IC correction above nu_c are applied on top. The values are kept
+ *              in Real even with single-precision grids: a float logarithm of the intensity loses too many digits.
+ ********************************************************************************************************************/
+struct LogSpectrum {
+    Real log_nu_break[3]{con::inf, con::inf, con::inf};      // Log of the spectral breaks, ascending (+inf if unused)
+    Real log_I[4]{-con::inf, -con::inf, -con::inf, -con::inf};  // Log intensity of each segment at its reference break
+};
+
 /********************************************************************************************************************
  * STRUCT: SynPhotons
- * DESCRIPTION: Represents synchrotron photons in the comoving frame and provides spectral functions.
+ * DESCRIPTION: Represents the synchrotron photons of a single cell in the comoving frame and provides spectral
+ *              functions. The electron quantities the spectrum depends on are copied in, so a SynPhotons is
+ *              self-contained and does not refer back to the electron grid.
  ********************************************************************************************************************/
 struct SynPhotons {
     // all in comoving frame
-    Real nu_m{0};                    // Characteristic frequency corresponding to gamma_m
-    Real nu_c{0};                    // Cooling frequency corresponding to gamma_c
-    Real nu_a{0};                    // Self-absorption frequency
-    Real nu_M{0};                    // Maximum photon frequency
-    const SynElectrons* e{nullptr};  // Pointer to the associated SynElectrons
+    Real nu_m{0};         // Characteristic frequency corresponding to gamma_m
+    Real nu_c{0};         // Cooling frequency corresponding to gamma_c
+    Real nu_a{0};         // Self-absorption frequency
+    Real nu_M{0};         // Maximum photon frequency
+    Real I_nu_peak{0};    // Peak intensity of the emitting electrons
+    Real p{2.3};          // Power-law index of the emitting electrons
+    Real Y_c{0};          // Compton Y parameter of the emitting electrons
+    size_t regime{0};     // Regime of the emitting electrons
+    InverseComptonY Ys;   // InverseComptonY parameters of the emitting electrons
 
     // Returns the intensity at a given frequency nu
     Real I_nu(Real nu) const;
-    // Updates internal constants used in the spectral calculations
+    // Returns the log intensity at a given frequency nu, with log_nu = log(nu)
+    Real log_I_nu(Real log_nu, Real nu) const;
+    // Returns the intensity integrated over the band [nu_lo, nu_hi]
+    Real I_nu_band(Real nu_lo, Real nu_hi) const;
+    // Updates the log-domain spectrum used in the spectral calculations
     void updateConstant();
 
    private:
-    /*Real a_m_1_3{0};     // (nu_a / nu_m)^(1/3)
-    Real c_m_1_2{0};     // (nu_c / nu_m)^(1/2)
-    Real m_a_pa4_2{0};   // (nu_m / nu_a)^((p+4)/2)
-    Real a_m_mpa1_2{0};  // (nu_a / nu_m)^((-p+1)/2)
-    Real a_c_1_3{0};     // (nu_a / nu_c)^(1/3)
-    Real a_m_1_2{0};     // (nu_a / nu_m)^(1/2)
-    Real R4{0};          // R coefficient for case 4 (Bing Zhang's Book, page 199)
-    Real R6{0};          // R coefficient for case 6 (Bing Zhang's Book, page 200)*/
-    Real C1_{0};
-    Real C2_{0};
-    Real C3_{0};
-
-    // Computes the photon spectrum at a given frequency nu
-    inline Real spectrum(Real nu) const;
+    LogSpectrum log_spec_;  // Spectrum segments (see LogSpectrum)
+
+    friend class SynPhotonGrid;
 };
 
 /********************************************************************************************************************
  * TYPE ALIASES
- * DESCRIPTION: Defines multi-dimensional grid types for Synchrotron Photons and Electrons.
+ * DESCRIPTION: Defines multi-dimensional grid types for Synchrotron Electrons.
+ ********************************************************************************************************************/
+using SynElectronGrid = boost::multi_array<SynElectrons, 3, GridAllocator<SynElectrons>>;
+
+/********************************************************************************************************************
+ * CLASS: SynPhotonGrid
+ * DESCRIPTION: Synchrotron photons of all cells, stored as a structure of arrays: each SynPhotons quantity is a
+ *              contiguous (phi, theta, t) grid. Evaluating the intensity of a cell reads the cell's entry of each
+ *              array, and a sweep along t (as in the observer's flux loop) streams through them without touching
+ *              the electron grid. The arrays hold Storage elements (see Storage), except the Real spectrum segments
+ *              (see LogSpectrum) and the one-byte regime. The peak intensity is folded into the spectrum segments and
+ *              not stored on its own; operator() recovers it from them. A cell takes 153 bytes in double and 129
+ *              bytes in single precision (SINGLE_PRECISION_GRIDS), most of it the Real segments and the IC
+ *              parameters. The grid is a snapshot of the electrons it was generated from; regenerate it after the
+ *              electrons change (e.g., after IC cooling).
+ ********************************************************************************************************************/
+class SynPhotonGrid {
+   public:
+    SynPhotonGrid(size_t phi_size, size_t theta_size, size_t t_size, ThreadPool* pool = nullptr);
+
+    StorageGrid3d nu_m;  // Characteristic frequency corresponding to gamma_m
+    StorageGrid3d nu_c;  // Cooling frequency corresponding to gamma_c
+    StorageGrid3d nu_a;  // Self-absorption frequency
+    StorageGrid3d nu_M;  // Maximum photon frequency
+    StorageGrid3d p;     // Power-law index of the emitting electrons
+    StorageGrid3d Y_c;   // Compton Y parameter of the emitting electrons
+    boost::multi_array<uint8_t, 3, GridAllocator<uint8_t>> regime;              // Regime of the emitting electrons
+    boost::multi_array<InverseComptonY, 3, GridAllocator<InverseComptonY>> Ys;  // IC parameters of the electrons
+    boost::multi_array<LogSpectrum, 3, GridAllocator<LogSpectrum>> log_spec;    // Spectrum segments (always Real)
+
+    // Returns the photons of cell (i, j, k)
+    SynPhotons operator()(size_t i, size_t j, size_t k) const;
+    // Stores the photons of cell (i, j, k)
+    void set(size_t i, size_t j, size_t k, SynPhotons const& ph);
+    // Returns the intensity of cell (i, j, k) at a given frequency nu
+    Real I_nu(size_t i, size_t j, size_t k, Real nu) const;
+    // Returns the log intensity of cell (i, j, k) at a given frequency nu, with log_nu = log(nu)
+    Real log_I_nu(size_t i, size_t j, size_t k, Real log_nu, Real nu) const;
+    // Writes the log intensities of cell (i, j, k) at n frequencies nu[0, n) (log_nu = log(nu)) to log_I[0, n),
+    // reading the cell once
+    void log_I_nu(size_t i, size_t j, size_t k, Real const* log_nu, Real const* nu, size_t n, Real* log_I) const;
+    // Returns the intensity of cell (i, j, k) integrated over the band [nu_lo, nu_hi]
+    Real I_nu_band(size_t i, size_t j, size_t k, Real nu_lo, Real nu_hi) const;
+
+    auto shape() const { return std::make_tuple(phi_size, theta_size, t_size); }
+
+   private:
+    size_t phi_size{0};    // Number of grid points in phi direction
+    size_t theta_size{0};  // Number of grid points in theta direction
+    size_t t_size{0};      // Number of grid points in time direction
+
+    size_t offset(size_t i, size_t j, size_t k) const { return (i * theta_size + j) * t_size + k; }
+};
+
+/********************************************************************************************************************
+ * STRUCT: SolverStats
+ * DESCRIPTION: Work of the per-cell electron solvers over a grid: the number of cells solved and, per solver, the
+ *              number of residual evaluations (one Y evaluation each for syn_gamma_M and syn_gamma_c, one log
+ *              evaluation for syn_gamma_m with p = 2, one gamma_c evaluation for effectiveYThomson). Closed-form
+ *              cases count nothing. Pass a pointer to the grid functions below to collect them.
+ ********************************************************************************************************************/
+struct SolverStats {
+    size_t cells{0};    // Cells solved
+    size_t gamma_M{0};  // Residual evaluations of syn_gamma_M
+    size_t gamma_m{0};  // Residual evaluations of syn_gamma_m
+    size_t gamma_c{0};  // Residual evaluations of syn_gamma_c
+    size_t Y{0};        // Residual evaluations of effectiveYThomson
+
+    SolverStats& operator+=(SolverStats const& other) {
+        cells += other.cells;
+        gamma_M += other.gamma_M;
+        gamma_m += other.gamma_m;
+        gamma_c += other.gamma_c;
+        Y += other.Y;
+        return *this;
+    }
+};
+
+/********************************************************************************************************************
+ * FUNCTION: shellGuess(Real prev, Real prev2)
+ * DESCRIPTION: Starting guess of a per-cell solver from its solutions at the k-1 (prev) and k-2 (prev2) cells of the
+ *              same shell, 0 if there are none. The solutions are smooth power laws of t along a shell away from the
+ *              spectral breaks, so the geometric extrapolation prev^2 / prev2 is usually much closer than prev.
  ********************************************************************************************************************/
-using SynPhotonGrid = boost::multi_array<SynPhotons, 3>;
-using SynElectronGrid = boost::multi_array<SynElectrons, 3>;
+inline Real shellGuess(Real prev, Real prev2) { return prev2 > 0 ? prev * (prev / prev2) : prev; }
 
 /********************************************************************************************************************
  * FUNCTION PROTOTYPES: Synchrotron Grid Creation and Generation
- * DESCRIPTION: Functions to create and generate grids for Synchrotron electrons and photons.
+ * DESCRIPTION: Functions to create and generate grids for Synchrotron electrons and photons. With a thread pool, the
+ *              cells are computed in parallel: genSynElectrons walks whole shells to warm-start its solvers (see
+ *              parallelForShells), genSynPhotons runs independent cells (see parallelForCells).
  ********************************************************************************************************************/
-SynElectronGrid createSynElectronGrid(size_t phi_size, size_t theta_size, size_t t_size);
-SynElectronGrid genSynElectrons(Shock const& shock, Real p, Real xi = 1);
+SynElectronGrid createSynElectronGrid(size_t phi_size, size_t theta_size, size_t t_size, ThreadPool* pool = nullptr);
+SynElectronGrid genSynElectrons(Shock const& shock, Real p, Real xi = 1, ThreadPool* pool = nullptr,
+                                SolverStats* stats = nullptr);
 
-SynPhotonGrid createSynPhotonGrid(size_t phi_size, size_t theta_size, size_t t_size);
-SynPhotonGrid genSynPhotons(Shock const& shock, SynElectronGrid const& electrons);
+SynPhotonGrid genSynPhotons(Shock const& shock, SynElectronGrid const& electrons, ThreadPool* pool = nullptr);
 
 /********************************************************************************************************************
  * FUNCTION PROTOTYPES: Synchrotron Update and Parameter Calculation
- * DESCRIPTION: Functions for updating electron grids and calculating synchrotron parameters.
+ * DESCRIPTION: Functions for updating electron grids and calculating synchrotron parameters. The gamma_M, gamma_m
+ *              and gamma_c solvers take a starting guess of the solution (0 for none) and add their residual
+ *              evaluations to iters if it is not null; the grid functions extrapolate the guess from the previous
+ *              cells of the shell (see shellGuess).
  ********************************************************************************************************************/
-void updateElectrons4Y(SynElectronGrid& e, Shock const& shock);
-Real syn_gamma_c(Real t_com, Real B, InverseComptonY const& Ys, Real p);
+void updateElectrons4Y(SynElectronGrid& e, Shock const& shock, ThreadPool* pool = nullptr,
+                       SolverStats* stats = nullptr);
+Real syn_gamma_M(Real B, InverseComptonY const& Ys, Real p, Real guess = 0, size_t* iters = nullptr);
+Real syn_gamma_m(Real Gamma_rel, Real gamma_M, Real eps_e, Real p, Real xi, Real guess = 0, size_t* iters = nullptr);
+Real syn_gamma_c(Real t_com, Real B, InverseComptonY const& Ys, Real p, Real guess = 0, size_t* iters = nullptr);
 Real syn_gamma_N_peak(Real gamma_a, Real gamma_m, Real gamma_c);
 Real syn_nu(Real gamma, Real B);
 
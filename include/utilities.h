@@ -9,6 +9,7 @@
 #define _UTILITIES_H_
 #include "macros.h"
 #include "mesh.h"
+#include "vector-math.h"
 /********************************************************************************************************************
  * FUNCTION: Basic Math Functions                                                                                   *
  * DESCRIPTION: Inline functions for specific power calculations, a step function, and unit conversion.             *
@@ -30,6 +31,17 @@ Real interpEqSpaced(Real x0, Array const& x, Array const& y, bool lo_extrap = fa
 Real loglogInterp(Real x0, Array const& x, Array const& y, bool lo_extrap = false, bool hi_extrap = false);
 Real loglogInterpEqSpaced(Real x0, Array const& x, Array const& y, bool lo_extrap = false, bool hi_extrap = false);
 
+/********************************************************************************************************************
+ * FUNCTION: powerLawIntegral
+ * DESCRIPTION: Closed-form integral over [nu_1, nu_2] (given as log_nu_1 <= log_nu_2) of the power law
+ *              I(nu) = exp(log_I + slope (log nu - log_nu_1)). Uses expm1, so slopes near -1 lose no accuracy.
+ ********************************************************************************************************************/
+inline Real powerLawIntegral(Real log_I, Real slope, Real log_nu_1, Real log_nu_2) {
+    Real q = slope + 1;
+    Real dlog_nu = log_nu_2 - log_nu_1;
+    return std::exp(log_I + log_nu_1) * (q == 0 ? dlog_nu : std::expm1(q * dlog_nu) / q);
+}
+
 /********************************************************************************************************************
  * FUNCTION: Root Finding (Bisection Method)                                                                        *
  * DESCRIPTION: Template function to find the root of a function using the bisection method.                        *
@@ -47,6 +59,61 @@ auto rootBisection(Fun f, decltype(f(0)) low, decltype(f(0)) high, decltype(f(0)
     return 0.5 * (high + low);
 }
 
+/********************************************************************************************************************
+ * FUNCTION: Root Finding (Safeguarded Newton Method)                                                               *
+ * DESCRIPTION: Finds a root of f inside a bracket [neg, pos] with f(neg) <= 0 <= f(pos) (either end may be the     *
+ *              larger one). fdf(x) returns the pair {f(x), f'(x)}. Newton steps start from guess (clamped into the *
+ *              bracket) and every evaluation shrinks the bracket. A step that leaves the bracket or does not halve *
+ *              the step before last is replaced by the false-position step between the bracket ends (or, while    *
+ *              the value at an end is unknown, by evaluating that end; bisection if false position fails), so     *
+ *              kinks of f cannot stall the solver. The final step is taken without another evaluation: near a     *
+ *              simple root, stopping once a step is below |x| * eps leaves an error of about (|x| * eps)^2. If     *
+ *              iters is not null, the number of fdf calls is added to it.                                          *
+ ********************************************************************************************************************/
+template <typename Fun>
+Real rootNewton(Fun fdf, Real neg, Real pos, Real guess, Real eps = 1e-6, size_t* iters = nullptr) {
+    Real x = std::min(std::max(guess, std::min(neg, pos)), std::max(neg, pos));
+    Real f_neg = std::numeric_limits<Real>::quiet_NaN();
+    Real f_pos = std::numeric_limits<Real>::quiet_NaN();
+    Real dx_old = std::abs(pos - neg);
+    size_t calls = 0;
+    for (; calls < 100;) {
+        auto [f, df] = fdf(x);
+        calls++;
+        if (f == 0) {
+            break;
+        }
+        if (f < 0) {
+            neg = x;
+            f_neg = f;
+        } else {
+            pos = x;
+            f_pos = f;
+        }
+
+        Real x_new = x - f / df;
+        if (!((x_new - neg) * (x_new - pos) <= 0) || std::abs(2 * (x_new - x)) > dx_old) {
+            if (std::isnan(f_neg) || std::isnan(f_pos)) {
+                x_new = std::isnan(f_pos) ? pos : neg;  // Probe the end whose value is unknown
+            } else {
+                x_new = neg + (pos - neg) * (f_neg / (f_neg - f_pos));
+                if (!((x_new - neg) * (x_new - pos) < 0)) {
+                    x_new = 0.5 * (neg + pos);
+                }
+            }
+        }
+        dx_old = std::abs(x_new - x);
+        x = x_new;
+        if (dx_old <= std::abs(x) * eps) {
+            break;
+        }
+    }
+    if (iters != nullptr) {
+        *iters += calls;
+    }
+    return x;
+}
+
 /********************************************************************************************************************
  * FUNCTION: Utility Templates                                                                                      *
  * DESCRIPTION: Template functions for computing the minimum and maximum of provided values.                        *
@@ -73,50 +140,19 @@ T max(T first, Args... args) {
 
 /********************************************************************************************************************
  * FUNCTION: Fast Exponential and Logarithm Functions                                                               *
- * DESCRIPTION: Inline functions that provide fast approximations of exponential and logarithm functions using      *
- *              alternative methods when EXTREME_SPEED is defined.                                                  *
+ * DESCRIPTION: Scalar exp and log used throughout the code. By default they are the standard library functions.   *
+ *              With -DEXTREME_SPEED they are the MathTier::Fast kernels of vector-math.h: relative error ~1e-8     *
+ *              (see benchVectorMath), results below ~1e-307 flushed to zero, and loops over them vectorize.        *
  ********************************************************************************************************************/
-inline Real fastExp(Real x) {
 #ifdef EXTREME_SPEED
-    if (std::isnan(x)) return std::numeric_limits<Real>::quiet_NaN();
-    if (x == std::numeric_limits<Real>::infinity()) return std::numeric_limits<Real>::infinity();
-    if (x == -std::numeric_limits<Real>::infinity()) return 0.0;
-
-    constexpr Real ln2 = 0.6931471805599453;
-    constexpr Real inv_ln2 = 1.4426950408889634;
-
-    Real y = x * inv_ln2;
-    int64_t k = static_cast<int64_t>(y + (y >= 0 ? 0.5 : -0.5));
-    Real r = x - k * ln2;
-
-    // Real p = 1.0 + r * (1.0 + r * (0.5 + r * (0.166666666666666 + r * 0.041666666666666664)));
-
-    Real p = 1.0 + r * (1.0 + r * (0.5 + r * (0.166666666666666)));
-
-    return std::ldexp(p, k);
+constexpr MathTier fast_math_tier = MathTier::Fast;
 #else
-    return std::exp(x);
+constexpr MathTier fast_math_tier = MathTier::Libm;
 #endif
-}
 
-inline Real fastLog(Real x) {
-#ifdef EXTREME_SPEED
-    if (x <= 0.0) return -std::numeric_limits<Real>::infinity();
-    if (std::isnan(x)) return std::numeric_limits<Real>::quiet_NaN();
-    if (x == std::numeric_limits<Real>::infinity()) return std::numeric_limits<Real>::infinity();
+inline Real fastExp(Real x) { return mathExp<fast_math_tier>(x); }
 
-    uint64_t bits;
-    std::memcpy(&bits, &x, sizeof(x));
-    int64_t exponent = ((bits >> 52) & 0x7FF) - 1023;
-    bits = (bits & 0x000FFFFFFFFFFFFFULL) | 0x3FF0000000000000ULL;
-    Real f;
-    std::memcpy(&f, &bits, sizeof(f));
-    Real p = -1.49278 + (2.11263 + (-0.729104 + 0.10969 * f) * f) * f;
-    return p + 0.6931471806 * exponent;
-#else
-    return std::log(x);
-#endif
-}
+inline Real fastLog(Real x) { return mathLog<fast_math_tier>(x); }
 
 inline Real fastPow(Real a, Real b) { return fastExp(b * fastLog(a)); }
 
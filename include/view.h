@@ -0,0 +1,157 @@
+//              __     __                            _      __  _                     _
+//              \ \   / /___   __ _   __ _  ___     / \    / _|| |_  ___  _ __  __ _ | |  ___ __      __
+//               \ \ / // _ \ / _` | / _` |/ __|   / _ \  | |_ | __|/ _ \| '__|/ _` || | / _ \\ \ /\ / /
+//                \ V /|  __/| (_| || (_| |\__ \  / ___ \ |  _|| |_|  __/| |  | (_| || || (_) |\ V  V /
+//                 \_/  \___| \__, | \__,_||___/ /_/   \_\|_|   \__|\___||_|   \__, ||_| \___/  \_/\_/
+//                            |___/                                            |___/
+
+#ifndef _VIEW_
+#define _VIEW_
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+/********************************************************************************************************************
+ * CLASS: View
+ * DESCRIPTION: Non-owning view of a Rank-dimensional grid: a raw pointer plus the extent and the stride (in elements)
+ *              of every dimension. Indexing is a multiply-add on the pointer without proxy objects, so loops over
+ *              views are as transparent to the optimizer as loops over raw arrays.
+ *                - v(i, j, k) returns an element,
+ *                - v[i] returns the (Rank - 1)-dimensional slice at i (an element for Rank 1),
+ *                - v.row(i, j) returns the 1D row along the last dimension.
+ *              Views of Array, MeshGrid, MeshGrid3d, Shock fields and std containers are made with view(). A view
+ *              of non-const elements converts to a view of const elements.
+ ********************************************************************************************************************/
+template <typename T, size_t Rank>
+class View {
+    static_assert(Rank >= 1, "View needs at least one dimension");
+
+   public:
+    using value_type = std::remove_const_t<T>;
+    static constexpr size_t rank{Rank};
+
+    View() = default;
+
+    // Strided view.
+    View(T* data, std::array<size_t, Rank> const& extents, std::array<size_t, Rank> const& strides)
+        : data_(data), extents_(extents), strides_(strides) {}
+
+    // Contiguous (row-major) view.
+    View(T* data, std::array<size_t, Rank> const& extents) : data_(data), extents_(extents) {
+        size_t stride = 1;
+        for (size_t d = Rank; d-- > 0;) {
+            strides_[d] = stride;
+            stride *= extents[d];
+        }
+    }
+
+    template <typename U, typename = std::enable_if_t<std::is_same_v<T, U const>>>
+    View(View<U, Rank> const& other) : View(other.data(), other.extents(), other.strides()) {}
+
+    template <typename... Idx>
+    T& operator()(Idx... idx) const {
+        static_assert(sizeof...(Idx) == Rank, "View needs one index per dimension");
+        return data_[offset(idx...)];
+    }
+
+    decltype(auto) operator[](size_t i) const {
+        if constexpr (Rank == 1) {
+            return data_[i * strides_[0]];
+        } else {
+            return View<T, Rank - 1>(data_ + i * strides_[0], tail(extents_), tail(strides_));
+        }
+    }
+
+    // Row along the last dimension at the given leading indices.
+    template <typename... Idx>
+    View<T, 1> row(Idx... idx) const {
+        static_assert(sizeof...(Idx) == Rank - 1, "View::row needs one index per leading dimension");
+        return View<T, 1>(data_ + offset(idx..., 0), {extents_[Rank - 1]}, {strides_[Rank - 1]});
+    }
+
+    T* data() const { return data_; }
+    size_t size() const { return extents_[0]; }
+    size_t extent(size_t d) const { return extents_[d]; }
+    size_t stride(size_t d) const { return strides_[d]; }
+    std::array<size_t, Rank> const& extents() const { return extents_; }
+    std::array<size_t, Rank> const& strides() const { return strides_; }
+
+    size_t num_elements() const {
+        size_t n = 1;
+        for (size_t d = 0; d < Rank; ++d) {
+            n *= extents_[d];
+        }
+        return n;
+    }
+
+   private:
+    T* data_{nullptr};
+    std::array<size_t, Rank> extents_{};
+    std::array<size_t, Rank> strides_{};
+
+    template <typename... Idx>
+    size_t offset(Idx... idx) const {
+        size_t d = 0;
+        size_t off = 0;
+        ((off += static_cast<size_t>(idx) * strides_[d++]), ...);
+        return off;
+    }
+
+    template <size_t N>
+    static std::array<size_t, N - 1> tail(std::array<size_t, N> const& a) {
+        std::array<size_t, N - 1> t;
+        for (size_t d = 1; d < N; ++d) {
+            t[d - 1] = a[d];
+        }
+        return t;
+    }
+};
+
+/********************************************************************************************************************
+ * TEMPLATE FUNCTION: view
+ * DESCRIPTION: Makes a View of a grid. Grids with zero-based boost::multi_array-style interfaces (origin(), shape()
+ *              and strides(); this includes Array, MeshGrid, MeshGrid3d and the strided Shock fields) keep their
+ *              strides; std::vector and std::array give contiguous 1D views; views are returned unchanged.
+ ********************************************************************************************************************/
+template <typename Grid>
+    requires requires(Grid& g) { g.origin(); g.strides(); }
+auto view(Grid& grid) {
+    using T = std::remove_pointer_t<decltype(grid.origin())>;
+    constexpr size_t Rank = std::remove_const_t<Grid>::dimensionality;
+    std::array<size_t, Rank> extents;
+    std::array<size_t, Rank> strides;
+    for (size_t d = 0; d < Rank; ++d) {
+        extents[d] = grid.shape()[d];
+        strides[d] = static_cast<size_t>(grid.strides()[d]);
+    }
+    return View<T, Rank>(grid.origin(), extents, strides);
+}
+
+template <typename T, typename Alloc>
+View<T, 1> view(std::vector<T, Alloc>& vec) {
+    return View<T, 1>(vec.data(), {vec.size()});
+}
+
+template <typename T, typename Alloc>
+View<T const, 1> view(std::vector<T, Alloc> const& vec) {
+    return View<T const, 1>(vec.data(), {vec.size()});
+}
+
+template <typename T, size_t N>
+View<T, 1> view(std::array<T, N>& arr) {
+    return View<T, 1>(arr.data(), {N});
+}
+
+template <typename T, size_t N>
+View<T const, 1> view(std::array<T, N> const& arr) {
+    return View<T const, 1>(arr.data(), {N});
+}
+
+template <typename T, size_t Rank>
+View<T, Rank> view(View<T, Rank> v) {
+    return v;
+}
+
+#endif
@@ -138,11 +138,16 @@ MeshGrid createGridLike(MeshGrid const& grid_old, Real val) {
 /********************************************************************************************************************
  * FUNCTION: create3DGrid
  * DESCRIPTION: Creates and returns a 3D MeshGrid (MeshGrid3d) with dimensions (phi_size x theta_size x r_size)
- *              filled with the value 'val'.
+ *              filled with the value 'val'. With a pool, the shells are first touched and filled by the pool threads
+ *              with the static partition of parallelForShells (see FirstTouchScope).
  ********************************************************************************************************************/
-MeshGrid3d create3DGrid(size_t phi_size, size_t theta_size, size_t t_size, Real val) {
+MeshGrid3d create3DGrid(size_t phi_size, size_t theta_size, size_t t_size, Real val, ThreadPool* pool) {
+    FirstTouchScope first_touch(pool, phi_size * theta_size);
     MeshGrid3d grid(boost::extents[phi_size][theta_size][t_size]);
-    std::fill(grid.data(), grid.data() + grid.num_elements(), val);
+    if (val != 0) {  // The grid is value-initialized (zeroed).
+        parallelForShells(pool, phi_size, theta_size,
+                          [&grid, val](size_t i, size_t j) { std::fill_n(grid[i][j].origin(), grid.shape()[2], val); });
+    }
     return grid;
 }
 
@@ -150,11 +155,20 @@ MeshGrid3d create3DGrid(size_t phi_size, size_t theta_size, size_t t_size, Real
  * FUNCTION: create3DGridLike
  * DESCRIPTION: Creates a 3D MeshGrid with the same shape as the provided grid 'grid_old', filled with the value 'val'.
  ********************************************************************************************************************/
-MeshGrid3d create3DGridLike(MeshGrid3d const& grid_old, Real val) {
+MeshGrid3d create3DGridLike(MeshGrid3d const& grid_old, Real val, ThreadPool* pool) {
     const size_t* shape = grid_old.shape();
-    MeshGrid3d grid(boost::extents[shape[0]][shape[1]][shape[2]]);
-    std::fill(grid.data(), grid.data() + grid.num_elements(), val);
-    return grid;
+    return create3DGrid(shape[0], shape[1], shape[2], val, pool);
+}
+
+/********************************************************************************************************************
+ * FUNCTION: createStorage3DGrid
+ * DESCRIPTION: Creates and returns a zeroed 3D grid of Storage elements (StorageGrid3d) with dimensions
+ *              (phi_size x theta_size x t_size). With a pool, the shells are first touched by the pool threads with
+ *              the static partition of parallelForShells (see FirstTouchScope).
+ ********************************************************************************************************************/
+StorageGrid3d createStorage3DGrid(size_t phi_size, size_t theta_size, size_t t_size, ThreadPool* pool) {
+    FirstTouchScope first_touch(pool, phi_size * theta_size);
+    return StorageGrid3d(boost::extents[phi_size][theta_size][t_size]);
 }
 
 /********************************************************************************************************************
@@ -9,6 +9,7 @@
 
 #include <cmath>
 
+#include "kernels.h"
 #include "macros.h"
 #include "physics.h"
 #include "utilities.h"
@@ -19,13 +20,95 @@
  *              interpolation in log-space. The result is returned in linear space.
  ********************************************************************************************************************/
 std::tuple<Real, Real, Real> LogScaleInterp::interpRID(Real t_obs) const {
-    Real log_t = fastLog(t_obs / t_obs_lo);
-    Real r = r_lo * fastExp(log_t * log_r_ratio / log_t_ratio);
-    Real D = d_lo * fastExp(log_t * log_d_ratio / log_t_ratio);
-    Real I = I_lo * fastExp(log_t * log_I_ratio / log_t_ratio);
+    Real log_t = fastLog(t_obs) - log_t_lo;
+    Real r = fastExp(log_r_lo + log_t * log_r_ratio / log_t_ratio);
+    Real D = fastExp(log_d_lo + log_t * log_d_ratio / log_t_ratio);
+    Real I = fastExp(log_I_lo + log_t * log_I_ratio / log_t_ratio);
     return std::make_tuple(r, I, D);
 }
 
+/********************************************************************************************************************
+ * METHOD: LogScaleInterp::addLogLinearRun
+ * DESCRIPTION: Adds solid_angle exp(log_F_lo + slope (log t - log t_lo)) for a run of observation times, so each
+ *              sample costs one exp, and the loop over the run vectorizes (MathTier::Accurate, or MathTier::Fast
+ *              with EXTREME_SPEED).
+ ********************************************************************************************************************/
+void LogScaleInterp::addLogLinearRun(Real* RESTRICT f_nu, Real const* RESTRICT log_t_obs, size_t first, size_t last,
+                                     Real log_F_lo, Real slope, Real log_t_lo, Real solid_angle) {
+#ifdef EXTREME_SPEED
+    constexpr MathTier tier = MathTier::Fast;
+#else
+    constexpr MathTier tier = MathTier::Accurate;
+#endif
+    for (size_t idx = first; idx < last; ++idx) {
+        f_nu[idx] += solid_angle * mathExp<tier>(log_F_lo + slope * (log_t_obs[idx] - log_t_lo));
+    }
+}
+
+/********************************************************************************************************************
+ * METHOD: LogScaleInterp::addFluxRun
+ * DESCRIPTION: Adds D^3 I r^2 solid_angle, interpolated as in interpRID, for a run of observation times inside the
+ *              current boundaries. In log space the contribution is linear in log t, log F = log F_lo + slope (log t -
+ *              log t_lo), which addLogLinearRun adds in one exp per sample instead of three exps and a log.
+ ********************************************************************************************************************/
+void LogScaleInterp::addFluxRun(Real* f_nu, Real const* log_t_obs, size_t first, size_t last,
+                                Real solid_angle) const {
+    Real log_F_lo = 3 * log_d_lo + log_I_lo + 2 * log_r_lo;
+    Real slope = (3 * log_d_ratio + log_I_ratio + 2 * log_r_ratio) / log_t_ratio;
+    addLogLinearRun(f_nu, log_t_obs, first, last, log_F_lo, slope, log_t_lo, solid_angle);
+}
+
+/********************************************************************************************************************
+ * CONSTRUCTOR: SpectrumInterp::SpectrumInterp
+ * DESCRIPTION: Copies the redshift and jet dimensionality of interp and stores (1 + z) nu_obs, from which the
+ *              comoving frequencies of a cell follow with one division each.
+ ********************************************************************************************************************/
+SpectrumInterp::SpectrumInterp(LogScaleInterp const& interp, Array const& nu_obs)
+    : z(interp.z),
+      jet_3d(interp.jet_3d),
+      nu_num(nu_obs.size()),
+      nu_z(nu_obs.size()),
+      nu(nu_obs.size()),
+      log_nu(nu_obs.size()),
+      log_I_lo(nu_obs.size()),
+      log_I_hi(nu_obs.size()),
+      active(nu_obs.size(), 0) {
+    for (size_t l = 0; l < nu_num; ++l) {
+        nu_z[l] = (1 + z) * nu_obs[l];
+    }
+}
+
+/********************************************************************************************************************
+ * METHOD: SpectrumInterp::startColumn
+ * DESCRIPTION: Reactivates all frequencies and forgets the cached upper boundary.
+ ********************************************************************************************************************/
+void SpectrumInterp::startColumn() {
+    std::fill(active.begin(), active.end(), 1);
+    active_num = nu_num;
+    idx_hi = 0;
+}
+
+/********************************************************************************************************************
+ * METHOD: SpectrumInterp::addFluxRun
+ * DESCRIPTION: LogScaleInterp::addFluxRun for every active frequency, into its row of f_nu.
+ ********************************************************************************************************************/
+void SpectrumInterp::addFluxRun(Real* f_nu, size_t stride, Real const* log_t_obs, size_t first, size_t last,
+                                Real solid_angle) const {
+    if (first == last) {
+        return;
+    }
+    for (size_t l = 0; l < nu_num; ++l) {
+        if (!active[l]) {
+            continue;
+        }
+        Real log_I_ratio = log_I_hi[l] - log_I_lo[l];
+        Real log_F_lo = 3 * log_d_lo + log_I_lo[l] + 2 * log_r_lo;
+        Real slope = (3 * log_d_ratio + log_I_ratio + 2 * log_r_ratio) / log_t_ratio;
+        LogScaleInterp::addLogLinearRun(f_nu + l * stride, log_t_obs, first, last, log_F_lo, slope, log_t_lo,
+                                        solid_angle);
+    }
+}
+
 /********************************************************************************************************************
  * TEMPLATE METHOD: Observer::changeViewingAngle
  * DESCRIPTION: Updates the Observer's viewing angle
@@ -39,7 +122,10 @@ void Observer::changeViewingAngle(Real theta_view) {
     }
     theta_obs = theta_view;
     calcSolidAngle();
-    calcObsTimeGrid();
+    calcViewCosine();
+    if (mode == ObserverMode::Materialized) {
+        calcObsTimeGrid();
+    }
 }
 
 /********************************************************************************************************************
@@ -58,31 +144,108 @@ void Observer::calcSolidAngle() {
 }
 
 /********************************************************************************************************************
- * METHOD: Observer::calcObsTimeGrid
- * DESCRIPTION: Calculates the observation time grid (t_obs_grid) and updates the doppler factor grid based on the
- *              Gamma (Lorentz factor) and engine time (t) array.
- *              For each grid point, the Doppler factor is computed and the observed time is calculated taking
- *              redshift into account.
+ * METHOD: Observer::createGeometryGrid
+ * DESCRIPTION: Creates a phi x theta x t grid for the observation times or Doppler factors in Materialized mode
+ *              (first touched on the pool), or an empty grid in OnTheFly mode.
  ********************************************************************************************************************/
-void Observer::calcObsTimeGrid() {
-    auto [phi_size, theta_size, t_size] = coord.shape();
+StorageGrid3d Observer::createGeometryGrid(Coord const& coord, ThreadPool* pool, ObserverMode mode) {
+    if (mode == ObserverMode::OnTheFly) {
+        return createStorage3DGrid(0, 0, 0);
+    }
+    return createStorage3DGrid(coord.phi.size(), coord.theta.size(), coord.t.size(), pool);
+}
+
+/********************************************************************************************************************
+ * METHOD: Observer::logTimes
+ * DESCRIPTION: Returns the logarithms of the observation times t_obs.
+ ********************************************************************************************************************/
+Array Observer::logTimes(Array const& t_obs) {
+    Array log_t_obs = zeros(t_obs.size());
+    for (size_t idx = 0; idx < t_obs.size(); ++idx) {
+        log_t_obs[idx] = fastLog(t_obs[idx]);
+    }
+    return log_t_obs;
+}
+
+/********************************************************************************************************************
+ * METHOD: Observer::calcViewCosine
+ * DESCRIPTION: Calculates, for each effective phi and theta grid point, the cosine of the angle between the local
+ *              velocity vector and the observer's line of sight for the current viewing angle. The trigonometric
+ *              functions are evaluated once per phi, theta and viewing angle rather than once per column.
+ ********************************************************************************************************************/
+void Observer::calcViewCosine() {
+    size_t theta_size = coord.theta.size();
     Real cos_obs = std::cos(theta_obs);
     Real sin_obs = std::sin(theta_obs);
+    Array sin_theta = zeros(theta_size);
+    Array cos_theta = zeros(theta_size);
+    for (size_t j = 0; j < theta_size; ++j) {
+        sin_theta[j] = std::sin(coord.theta[j]);
+        cos_theta[j] = std::cos(coord.theta[j]);
+    }
     for (size_t i = 0; i < eff_phi_size; ++i) {
         Real cos_phi = std::cos(coord.phi[i]);
         for (size_t j = 0; j < theta_size; ++j) {
-            // Compute the cosine of the angle between the local velocity vector and the observer's line of sight.
-            Real cos_v = std::sin(coord.theta[j]) * cos_phi * sin_obs + std::cos(coord.theta[j]) * cos_obs;
-            for (size_t k = 0; k < t_size; ++k) {
-                Real gamma_ = Gamma[i * interp.jet_3d][j][k];  // Get Gamma at the grid point.
-                Real r = r_grid[i * interp.jet_3d][j][k];
-                Real t_eng_ = coord.t[k];         // Get engine time at the grid point.
-                Real beta = gammaTobeta(gamma_);  // Convert Gamma to beta.
-                // Compute the Doppler factor: D = 1 / [Gamma * (1 - beta * cos_v)]
-                doppler[i][j][k] = 1 / (gamma_ * (1 - beta * cos_v));
-                // Compute the observed time: t_obs = [t_eng + (1 - cos_v) * r / c] * (1 + z)
-                t_obs_grid[i][j][k] = (t_eng_ + (1 - cos_v) * r / con::c) * (1 + z);
-            }
+            cos_v[i][j] = sin_theta[j] * cos_phi * sin_obs + cos_theta[j] * cos_obs;
+        }
+    }
+}
+
+/********************************************************************************************************************
+ * METHOD: Observer::calcColumnGeometry
+ * DESCRIPTION: Calculates the observation time (t_grid) and Doppler factor (D) rows of the (i, j) column from the
+ *              Gamma (Lorentz factor) and radius rows, the engine time (t) array and the cosine of the angle between
+ *              the column's velocity and the line of sight (cos_view; cos_v[i][j] for the current viewing angle, see
+ *              calcViewCosine). For each grid point, the Doppler factor is computed and the observed
+ *              time is calculated taking redshift into account. Contiguous output rows go through the vectorized
+ *              columnGeometryKernel; strided Gamma and radius rows (AoS/AoSoA Shock layouts) are first gathered into
+ *              per-thread buffers.
+ ********************************************************************************************************************/
+void Observer::calcColumnGeometry(size_t i, size_t j, Real cos_view, View<Storage, 1> t_grid,
+                                  View<Storage, 1> D) const {
+    size_t t_size = coord.t.size();
+    auto Gamma_row = view(Gamma).row(i * interp.jet_3d, j);
+    auto r_row = view(r_grid).row(i * interp.jet_3d, j);
+    if (t_grid.stride(0) != 1 || D.stride(0) != 1) {
+        for (size_t k = 0; k < t_size; ++k) {
+            Real gamma_ = Gamma_row[k];  // Get Gamma at the grid point.
+            Real r = r_row[k];
+            Real t_eng_ = coord.t[k];         // Get engine time at the grid point.
+            Real beta = gammaTobeta(gamma_);  // Convert Gamma to beta.
+            // Compute the Doppler factor: D = 1 / [Gamma * (1 - beta * cos_v)]
+            D[k] = 1 / (gamma_ * (1 - beta * cos_view));
+            // Compute the observed time: t_obs = [t_eng + (1 - cos_v) * r / c] * (1 + z)
+            t_grid[k] = (t_eng_ + (1 - cos_view) * r / con::c) * (1 + z);
+        }
+        return;
+    }
+    Real const* Gamma_ = Gamma_row.data();
+    Real const* r_ = r_row.data();
+    if (Gamma_row.stride(0) != 1 || r_row.stride(0) != 1) {
+        thread_local std::vector<Real> Gamma_buf;
+        thread_local std::vector<Real> r_buf;
+        Gamma_buf.resize(t_size);
+        r_buf.resize(t_size);
+        for (size_t k = 0; k < t_size; ++k) {
+            Gamma_buf[k] = Gamma_row[k];
+            r_buf[k] = r_row[k];
         }
+        Gamma_ = Gamma_buf.data();
+        r_ = r_buf.data();
     }
+    columnGeometryKernel(D.data(), t_grid.data(), Gamma_, r_, coord.t.data(), t_size, cos_view, z);
+}
+
+/********************************************************************************************************************
+ * METHOD: Observer::calcObsTimeGrid
+ * DESCRIPTION: Fills the observation time grid (t_obs_grid) and the Doppler factor grid column by column (see
+ *              calcColumnGeometry), with the static shell partition the grids were first touched with (see
+ *              createStorage3DGrid). Only used in Materialized mode.
+ ********************************************************************************************************************/
+void Observer::calcObsTimeGrid() {
+    auto t_obs_ = view(t_obs_grid);
+    auto D_ = view(doppler);
+    parallelForShells(pool, eff_phi_size, coord.theta.size(), [&](size_t i, size_t j) {
+        calcColumnGeometry(i, j, cos_v[i][j], t_obs_.row(i, j), D_.row(i, j));
+    });
 }
\ No newline at end of file
@@ -7,41 +7,107 @@
 
 #include "shock.h"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
 #include "afterglow.h"
 #include "macros.h"
 #include "mesh.h"
 #include "physics.h"
 #include "utilities.h"
 
+/********************************************************************************************************************
+ * FUNCTION: createShockStorage
+ * DESCRIPTION: Allocates the single block holding the five Shock fields in the given layout, zeroed. With a pool,
+ *              the (phi, theta) shells of every field are first touched by the pool threads with the static
+ *              partition of parallelForShells (see FirstTouchScope).
+ ********************************************************************************************************************/
+ShockStorage createShockStorage(size_t phi_size, size_t theta_size, size_t t_size, ShockLayout layout,
+                                ThreadPool* pool) {
+    constexpr size_t field_num = 5;
+    FirstTouchScope scope(pool, phi_size * theta_size, layout == ShockLayout::SoA ? field_num : 1);
+    switch (layout) {
+        case ShockLayout::AoSoA:
+            return ShockStorage(boost::extents[phi_size][theta_size][field_num][t_size]);
+        case ShockLayout::AoS:
+            return ShockStorage(boost::extents[phi_size][theta_size][t_size][field_num]);
+        default:
+            return ShockStorage(boost::extents[field_num][phi_size][theta_size][t_size]);
+    }
+}
+
 /********************************************************************************************************************
  * CONSTRUCTOR: Shock::Shock
  * DESCRIPTION: Constructs a Shock object with the given grid dimensions (phi_size, theta_size, t_size)
- *              and energy fractions (eps_e and eps_B). The constructor initializes various 3D grids for storing
- *              comoving time (t_com), engine time (t_eng), relative Lorentz factor (Gamma_rel), magnetic field (B),
- *              and downstream proton column density (column_num_den). Default initial values are provided via
- *create3DGrid.
+ *              and energy fractions (eps_e and eps_B). The constructor allocates the five fields, comoving time
+ *              (t_com), radius (r), relative Lorentz factor (Gamma_rel), magnetic field (B) and downstream proton
+ *              column density (column_num_den), in a single block with the given layout and binds the field views.
+ *              All fields start at 0, except Gamma_rel, which is initialized with 1.
  ********************************************************************************************************************/
-Shock::Shock(size_t phi_size, size_t theta_size, size_t t_size, Real eps_e, Real eps_B)
-    : t_com(boost::extents[phi_size][theta_size][t_size]),           // Initialize comoving time grid with 0
-      r(boost::extents[phi_size][theta_size][t_size]),               // Initialize engine time grid with 0
-      Gamma_rel(boost::extents[phi_size][theta_size][t_size]),       // Initialize Gamma_rel grid with 1
-      B(boost::extents[phi_size][theta_size][t_size]),               // Initialize magnetic field grid with 0
-      column_num_den(boost::extents[phi_size][theta_size][t_size]),  // Initialize column density grid with 0
-      eps_e(eps_e),                                                  // Set electron energy fraction
-      eps_B(eps_B),                                                  // Set magnetic energy fraction
-      phi_size(phi_size),                                            // Store phi grid size
-      theta_size(theta_size),                                        // Store theta grid size
+Shock::Shock(size_t phi_size, size_t theta_size, size_t t_size, Real eps_e, Real eps_B, ThreadPool* pool,
+             ShockLayout layout)
+    : data(createShockStorage(phi_size, theta_size, t_size, layout, pool)),
+      layout(layout),
+      t_com(field(0)),
+      r(field(1)),
+      Gamma_rel(field(2)),
+      B(field(3)),
+      column_num_den(field(4)),
+      eps_e(eps_e),            // Set electron energy fraction
+      eps_B(eps_B),            // Set magnetic energy fraction
+      phi_size(phi_size),      // Store phi grid size
+      theta_size(theta_size),  // Store theta grid size
       t_size(t_size) {
-    std::memset(t_com.data(), 0, t_com.num_elements() * sizeof(Real));
-    std::memset(r.data(), 0, r.num_elements() * sizeof(Real));
-    std::fill(Gamma_rel.data(), Gamma_rel.data() + Gamma_rel.num_elements(), 1);  // Initialize Gamma_rel to 1
-    std::memset(B.data(), 0, B.num_elements() * sizeof(Real));
-    std::memset(column_num_den.data(), 0, column_num_den.num_elements() * sizeof(Real));
+    parallelForShells(pool, phi_size, theta_size, [&](size_t i, size_t j) {
+        for (size_t k = 0; k < t_size; ++k) {
+            Gamma_rel[i][j][k] = 1;
+        }
+    });
 }
 
-// Computes the downstream fluid velocity (u) for a given relative Lorentz factor (gamma_rel) and magnetization (sigma).
-// This function uses the adiabatic index computed from gamma_rel and applies different formulas based on sigma.
-Real u_DownStr(Real gamma_rel, Real sigma) {
+/********************************************************************************************************************
+ * CONSTRUCTOR: Shock::Shock(Shock const&)
+ * DESCRIPTION: Copies the fields of another Shock and binds the field views to the copy.
+ ********************************************************************************************************************/
+Shock::Shock(Shock const& other)
+    : data(other.data),
+      layout(other.layout),
+      t_com(field(0)),
+      r(field(1)),
+      Gamma_rel(field(2)),
+      B(field(3)),
+      column_num_den(field(4)),
+      eps_e(other.eps_e),
+      eps_B(other.eps_B),
+      phi_size(other.phi_size),
+      theta_size(other.theta_size),
+      t_size(other.t_size) {}
+
+/********************************************************************************************************************
+ * METHOD: Shock::field
+ * DESCRIPTION: Returns the (phi, theta, t) view of field f into the Shock's storage for the Shock's layout.
+ ********************************************************************************************************************/
+ShockField Shock::field(size_t f) {
+    using range = boost::multi_array_types::index_range;
+    switch (layout) {
+        case ShockLayout::AoSoA:
+            return data[boost::indices[range()][range()][f][range()]];
+        case ShockLayout::AoS:
+            return data[boost::indices[range()][range()][range()][f]];
+        default:
+            return data[boost::indices[f][range()][range()][range()]];
+    }
+}
+
+/********************************************************************************************************************
+ * FUNCTION: u_DownStrExact
+ * DESCRIPTION: Computes the downstream fluid four-velocity (u) for a given relative Lorentz factor (gamma_rel) and
+ *              magnetization (sigma). It uses the adiabatic index computed from gamma_rel; for sigma > 0, u^2 is the
+ *              physical root of the jump condition cubic.
+ ********************************************************************************************************************/
+Real u_DownStrExact(Real gamma_rel, Real sigma) {
     Real ad_idx = adiabaticIndex(gamma_rel);
     Real gamma_m_1 = gamma_rel - 1;  // (gamma_rel - 1)
     Real ad_idx_m_2 = ad_idx - 2;    // (ad_idx - 2)
@@ -73,11 +139,166 @@ Real u_DownStr(Real gamma_rel, Real sigma) {
         Real P = c - b * b / 3;
         Real Q = 2 * b * b * b / 27 - b * c / 3 + d;
         Real u = std::sqrt(-P / 3);
-        Real uds = 2 * u * std::cos(std::acos((3 * Q / (2 * P * u)) - 2 * con::pi) / 3) - b / 3;
+        // The physical root is the middle one of the three positive roots. Taking it from the trigonometric formula
+        // cancels terms of order gamma_rel^2, so it is found from the largest root z3 (no cancellation) and the
+        // Vieta relations z1 z2 = -d / z3 and z1 + z2 = (c - z1 z2) / z3 instead. For large gamma_rel the acos argument
+        // rounds past 1, hence the clamp.
+        Real z3 = 2 * u * std::cos(std::acos(std::clamp<Real>(3 * Q / (2 * P * u), -1, 1)) / 3) - b / 3;
+        Real prod = -d / z3;
+        Real sum = (c - prod) / z3;
+        Real uds = (sum + std::sqrt(std::max<Real>(sum * sum - 4 * prod, 0))) / 2;
         return std::sqrt(uds);
     }
 }
 
+/********************************************************************************************************************
+ * CLASS: JumpConditionTable
+ * DESCRIPTION: Table of log(u_DownStrExact) for sigma > 0 on a uniform grid in x = log(gamma_rel - 1) and
+ *              y = log(sigma), interpolated with 4x4-point (bicubic Lagrange) stencils. The exact solver needs an acos,
+ *              a cos and four square roots per call, and it runs in every shock state update and in every step of
+ *              the reverse shock ODE. The table is built on first use. Every cell is checked at its center and at
+ *              the midpoints of its lower and left edges, where the interpolation error peaks, and cells whose
+ *              relative error there exceeds tolerance / 2 are evaluated exactly, as are points outside the table.
+ *              Since sigma is fixed for a given ejecta, lookups go through a Slice: the table interpolated in y once
+ *              for one sigma, which leaves a 4-point interpolation in x per lookup. The log and exp of a lookup use
+ *              the Fast tier (see vector-math.h), whose ~1e-8 errors take at most ~1e-7 of the other half of the
+ *              error budget.
+ ********************************************************************************************************************/
+class JumpConditionTable {
+   public:
+    static constexpr Real tolerance{1e-6};  // Relative error bound of the tabulated u
+    static constexpr size_t x_num{320};     // Nodes in log(gamma_rel - 1)
+    static constexpr size_t y_num{160};     // Nodes in log(sigma)
+
+    // The table at one sigma.
+    class Slice {
+       public:
+        Real sigma{0};  // Magnetization of the slice (0 if empty)
+
+        // Returns u_DownStr(gamma_rel, sigma).
+        Real operator()(Real gamma_rel) const {
+            Real t = (mathLog<MathTier::Fast>(gamma_rel - 1) - x_min) * inv_dx;
+            if (!(t >= 0 && t < x_num - 1) || exact[static_cast<size_t>(t)]) {
+                return u_DownStrExact(gamma_rel, sigma);
+            }
+            size_t i = std::clamp<size_t>(static_cast<size_t>(t), 1, x_num - 3);
+            Real w[4];
+            weights(t - i, w);
+            return mathExp<MathTier::Fast>(w[0] * log_u[i - 1] + w[1] * log_u[i] + w[2] * log_u[i + 1] +
+                                           w[3] * log_u[i + 2]);
+        }
+
+       private:
+        friend class JumpConditionTable;
+        Real x_min{0};
+        Real inv_dx{0};
+        std::array<Real, x_num> log_u{};  // log(u) at the x nodes
+        std::array<bool, x_num> exact{};  // Cells evaluated exactly (all of them outside the sigma range)
+    };
+
+    JumpConditionTable() : log_u(x_num * y_num), exact(x_num * y_num, false) {
+        for (size_t i = 0; i < x_num; ++i) {
+            for (size_t j = 0; j < y_num; ++j) {
+                log_u[i * y_num + j] = std::log(u_DownStrExact(1 + std::exp(x_min + i * dx), std::exp(y_min + j * dy)));
+            }
+        }
+        for (size_t i = 0; i + 1 < x_num; ++i) {
+            for (size_t j = 0; j + 1 < y_num; ++j) {
+                // A NaN error (e.g., from a NaN node) also marks the cell exact.
+                bool accurate = true;
+                for (auto [fx, fy] : {std::pair{0.5, 0.5}, std::pair{0.5, 0.}, std::pair{0., 0.5}}) {
+                    Real x = x_min + (i + fx) * dx;
+                    Real y = y_min + (j + fy) * dy;
+                    Real u = u_DownStrExact(1 + std::exp(x), std::exp(y));
+                    Real err = std::abs(std::exp(interp(x, y)) / u - 1);
+                    if (!(err <= tolerance / 2)) {
+                        accurate = false;
+                    }
+                }
+                exact[i * y_num + j] = !accurate;
+            }
+        }
+    }
+
+    // Interpolates the table to the given sigma.
+    Slice slice(Real sigma) const {
+        Slice s;
+        s.sigma = sigma;
+        s.x_min = x_min;
+        s.inv_dx = 1 / dx;
+        Real ty = (std::log(sigma) - y_min) / dy;
+        if (!(ty >= 0 && ty < y_num - 1)) {
+            s.exact.fill(true);
+            return s;
+        }
+        size_t j = std::clamp<size_t>(static_cast<size_t>(ty), 1, y_num - 3);
+        Real w[4];
+        weights(ty - j, w);
+        for (size_t i = 0; i < x_num; ++i) {
+            Real const* row = &log_u[i * y_num + j - 1];
+            s.log_u[i] = w[0] * row[0] + w[1] * row[1] + w[2] * row[2] + w[3] * row[3];
+            s.exact[i] = exact[i * y_num + static_cast<size_t>(ty)];
+        }
+        return s;
+    }
+
+   private:
+    Real const x_min{std::log(1e-6)};  // gamma_rel - 1 from 1e-6 ...
+    Real const x_max{std::log(1e4)};   // ... to 1e4
+    Real const y_min{std::log(1e-6)};  // sigma from 1e-6 ...
+    Real const y_max{std::log(1e3)};   // ... to 1e3
+    Real const dx{(x_max - x_min) / (x_num - 1)};
+    Real const dy{(y_max - y_min) / (y_num - 1)};
+    std::vector<Real> log_u;  // [x][y] node values
+    std::vector<bool> exact;  // [x][y] cells evaluated exactly
+
+    // Lagrange weights of the nodes -1, 0, 1, 2 at the offset f.
+    static void weights(Real f, Real w[4]) {
+        Real fm1 = f - 1;
+        Real fm2 = f - 2;
+        Real fp1 = f + 1;
+        w[0] = -f * fm1 * fm2 / 6;
+        w[1] = fp1 * fm1 * fm2 / 2;
+        w[2] = -fp1 * f * fm2 / 2;
+        w[3] = fp1 * f * fm1 / 6;
+    }
+
+    // Interpolated log(u) at (x, y) inside the table; the stencils are shifted inwards at the edges.
+    Real interp(Real x, Real y) const {
+        Real tx = (x - x_min) / dx;
+        Real ty = (y - y_min) / dy;
+        size_t i = std::clamp<size_t>(static_cast<size_t>(tx), 1, x_num - 3);
+        size_t j = std::clamp<size_t>(static_cast<size_t>(ty), 1, y_num - 3);
+        Real wx[4], wy[4];
+        weights(tx - i, wx);
+        weights(ty - j, wy);
+        Real sum = 0;
+        for (size_t a = 0; a < 4; ++a) {
+            Real const* row = &log_u[(i - 1 + a) * y_num + j - 1];
+            sum += wx[a] * (wy[0] * row[0] + wy[1] * row[1] + wy[2] * row[2] + wy[3] * row[3]);
+        }
+        return sum;
+    }
+};
+
+/********************************************************************************************************************
+ * FUNCTION: u_DownStr
+ * DESCRIPTION: Downstream fluid four-velocity, as u_DownStrExact. The magnetized case is interpolated from the
+ *              JumpConditionTable (relative error below JumpConditionTable::tolerance) through a per-thread slice
+ *              for the last sigma; sigma = 0 is solved directly.
+ ********************************************************************************************************************/
+Real u_DownStr(Real gamma_rel, Real sigma) {
+    if (sigma == 0) {
+        return u_DownStrExact(gamma_rel, sigma);
+    }
+    static JumpConditionTable const table;
+    thread_local JumpConditionTable::Slice slice;
+    if (slice.sigma != sigma) {
+        slice = table.slice(sigma);
+    }
+    return slice(gamma_rel);
+}
+
 Real u_UpStr2u_DownStr(Real gamma_rel, Real sigma) {
     Real u_down_s_ = u_DownStr(gamma_rel, sigma);
     Real u_up_s_ = u_UpStr(u_down_s_, gamma_rel);
@@ -10,6 +10,7 @@
 #include <cmath>
 #include <iostream>
 #include <thread>
+#include <utility>
 
 #include "macros.h"
 #include "utilities.h"
@@ -30,11 +31,114 @@ ICPhotonGrid createICPhotonGrid(size_t phi_size, size_t theta_size, size_t r_siz
 inline bool order(Real a, Real b, Real c) { return a < b && b < c; }
 
 /********************************************************************************************************************
- * METHOD: ICPhoton::I_nu
- * DESCRIPTION: Computes the photon intensity at frequency nu using logarithmic-logarithmic interpolation
- *              (specifically, loglogInterpEqSpaced) on the IC photon spectrum data.
+ * METHOD: ICPhoton::storeSpectrum
+ * DESCRIPTION: Stores the integrated spectrum as log-intensities, together with the log bounds of the frequency grid
+ *              that log_I_nu needs to locate a frequency without taking further logs.
  ********************************************************************************************************************/
-Real ICPhoton::I_nu(Real nu) const { return loglogInterpEqSpaced(nu, this->nu_IC_, this->j_nu_, true, true); }
+void ICPhoton::storeSpectrum(IntegratorGrid const& grid) {
+    log_nu_min_ = std::log(grid.nu_IC[0]);
+    inv_dlog_nu_ = (spectrum_resol - 1) / (std::log(grid.nu_IC[spectrum_resol - 1]) - log_nu_min_);
+    for (size_t k = 0; k < spectrum_resol; ++k) {
+        log_j_nu_[k] = std::log(grid.j_nu[k]);
+    }
+}
+
+/********************************************************************************************************************
+ * METHOD: ICPhoton::I_nu_band
+ * DESCRIPTION: Integrates the spectrum of log_I_nu over [nu_lo, nu_hi]. Between two tabulated frequencies (and
+ *              beyond the table, where log_I_nu extrapolates the outermost pair) the spectrum is a power law, so the
+ *              band is cut at the tabulated frequencies and every piece is integrated in closed form.
+ ********************************************************************************************************************/
+Real ICPhoton::I_nu_band(Real nu_lo, Real nu_hi) const {
+    if (!(nu_hi > nu_lo)) {
+        return 0;
+    }
+    Real log_lo = fastLog(nu_lo);
+    Real log_hi = fastLog(nu_hi);
+    auto index = [&](Real log_nu) {
+        Real t = (log_nu - log_nu_min_) * inv_dlog_nu_;
+        return static_cast<size_t>(std::min(Real(spectrum_resol - 2), std::max(Real(0), t)));
+    };
+    auto node = [&](size_t idx) { return log_nu_min_ + idx / inv_dlog_nu_; };
+
+    size_t first = index(log_lo);
+    size_t last = index(log_hi);
+    Real I = 0;
+    for (size_t idx = first; idx <= last; ++idx) {
+        Real lo = log_j_nu_[idx];
+        Real hi = log_j_nu_[idx + 1];
+        if (lo == -con::inf || hi == -con::inf) {
+            continue;
+        }
+        Real slope = (hi - lo) * inv_dlog_nu_;
+        Real log_nu_1 = idx == first ? log_lo : node(idx);
+        Real log_nu_2 = idx == last ? log_hi : node(idx + 1);
+        I += powerLawIntegral(lo + slope * (log_nu_1 - node(idx)), slope, log_nu_1, log_nu_2);
+    }
+    return I;
+}
+
+/********************************************************************************************************************
+ * METHOD: ICPhoton::integrate
+ * DESCRIPTION: Integrates the differential contributions I0 into the IC spectrum. The cell (nu0, gamma) contributes
+ *              to the IC frequency nu if nu0 <= nu <= 4 gamma^2 nu0 IC_x0. For a fixed nu0 bin, this window opens at
+ *              the first nu >= nu0 and then admits every gamma from the smallest one whose upper edge reaches nu,
+ *              which only grows with nu. So, after replacing every row of I0 by its cumulative sums from the top in
+ *              gamma, each (nu0, nu) pair needs a single lookup, and the first admitted gamma is found by a pointer
+ *              that moves forward with nu. This takes O(num * (num + spectrum_resol)) operations instead of
+ *              O(spectrum_resol * num^2) and evaluates the window condition exactly as integrateBruteForce does, so
+ *              both sum the same terms and differ only by rounding.
+ ********************************************************************************************************************/
+void ICPhoton::integrate(IntegratorGrid& grid) {
+    constexpr size_t num = IntegratorGrid::num;
+
+    // I0[i][j] <- sum of I0[i][j'] over j' >= j.
+    for (size_t i = 0; i < num; ++i) {
+        for (size_t j = num - 1; j > 0; --j) {
+            grid.I0[i][j - 1] += grid.I0[i][j];
+        }
+    }
+
+    for (size_t i = 0; i < num; ++i) {
+        Real nu0_ = grid.x[i];
+        size_t j = 0;  // First gamma bin whose window reaches grid.nu_IC[k]
+        for (size_t k = 0; k < spectrum_resol; ++k) {
+            // The conditions are negated rather than inverted, so that NaNs (empty cells) fail them as they do in
+            // integrateBruteForce.
+            if (!(nu0_ <= grid.nu_IC[k])) {
+                continue;
+            }
+            while (j < num && !(grid.nu_IC[k] <= 4 * grid.y[j] * grid.y[j] * nu0_ * IC_x0)) {
+                ++j;
+            }
+            if (j == num) {
+                break;
+            }
+            grid.j_nu[k] += grid.I0[i][j] * grid.nu_IC[k];
+        }
+    }
+    storeSpectrum(grid);
+}
+
+/********************************************************************************************************************
+ * METHOD: ICPhoton::integrateBruteForce
+ * DESCRIPTION: Reference integration of I0 into the IC spectrum: for every IC frequency, sums the contributions of
+ *              all grid cells whose scattering window contains it.
+ ********************************************************************************************************************/
+void ICPhoton::integrateBruteForce(IntegratorGrid& grid) {
+    for (size_t k = 0; k < spectrum_resol; ++k) {
+        for (size_t i = 0; i < grid.num; ++i) {
+            Real nu0_ = grid.x[i];
+            for (size_t j = 0; j < grid.num; ++j) {
+                Real gamma_ = grid.y[j];
+                if (nu0_ <= grid.nu_IC[k] && grid.nu_IC[k] <= 4 * gamma_ * gamma_ * nu0_ * IC_x0) {
+                    grid.j_nu[k] += grid.I0[i][j] * grid.nu_IC[k];
+                }
+            }
+        }
+    }
+    storeSpectrum(grid);
+}
 
 /********************************************************************************************************************
  * INLINE FUNCTION: eta_rad
@@ -47,46 +151,55 @@ inline Real eta_rad(Real gamma_m, Real gamma_c, Real p) {
 
 /********************************************************************************************************************
  * FUNCTION: effectiveYThomson
- * DESCRIPTION: Computes the effective Compton Y parameter in the Thomson regime.
- *              It iteratively solves for Y until convergence using the relation:
- *                  Y0 = (sqrt(1+4b) - 1)/2,
- *              where b = (ηₑ * eps_e / eps_B). The electron cooling parameters are updated during each iteration.
+ * DESCRIPTION: Computes the effective Compton Y parameter in the Thomson regime, the self-consistent solution of
+ *                  Y (1 + Y) = ηₑ(gamma_c(Y)) * eps_e / eps_B,
+ *              where gamma_c(Y) is the Thomson cooling Lorentz factor (syn_gamma_c with a constant Y). The left side
+ *              grows faster than the right side, so the root is unique; it is found with rootNewton, bracketed by
+ *              [0, Y_hi] with Y_hi (1 + Y_hi) the largest value of the right side. guess is the Y of a neighbouring
+ *              cell (0 for none); otherwise the solver starts from the Y implied by the current e.gamma_c.
  ********************************************************************************************************************/
-Real effectiveYThomson(Real B, Real t_com, Real eps_e, Real eps_B, SynElectrons const& e) {
-    Real eta_e = eta_rad(e.gamma_m, e.gamma_c, e.p);
-    Real b = eta_e * eps_e / eps_B;
-    Real Y0 = (std::sqrt(1 + 4 * b) - 1) / 2;
-    Real Y1 = 2 * Y0;
-    for (; std::abs((Y1 - Y0) / Y0) > 1e-5;) {
-        Y1 = Y0;
-        Real gamma_c = syn_gamma_c(t_com, B, e.Ys, e.p);
-        eta_e = eta_rad(e.gamma_m, gamma_c, e.p);
-        b = eta_e * eps_e / eps_B;
-        Y0 = (std::sqrt(1 + 4 * b) - 1) / 2;
-    }
-    return Y0;
+Real effectiveYThomson(Real B, Real t_com, Real eps_e, Real eps_B, SynElectrons const& e, Real guess, size_t* iters) {
+    Real ratio = eps_e / eps_B;
+    auto gamma_c = [&](Real Y) { return syn_gamma_c(t_com, B, InverseComptonY(Y), e.p); };
+    auto Y_of = [](Real b) { return (std::sqrt(1 + 4 * b) - 1) / 2; };
+
+    // eta_e <= 1 for p >= 2; for p < 2 it decreases with Y and is largest at Y = 0.
+    Real b_max = e.p >= 2 ? ratio : ratio * eta_rad(e.gamma_m, gamma_c(0), e.p);
+    Real Y0 = guess > 0 ? guess : Y_of(ratio * eta_rad(e.gamma_m, e.gamma_c, e.p));
+
+    return rootNewton(
+        [&](Real Y) {
+            Real gamma_bar = (6 * con::pi * con::me * con::c / con::sigmaT) / (B * B * (1 + Y) * t_com);
+            Real root = std::sqrt(gamma_bar * gamma_bar + 4);
+            Real gamma = (gamma_bar + root) / 2;
+            Real eta_e = eta_rad(e.gamma_m, gamma, e.p);
+            // d eta_e / dY = eta_e (2 - p) d log gamma_c / dY above gamma_m, with
+            // d log gamma_c / dY = -gamma_bar / (sqrt(gamma_bar^2 + 4) (1 + Y))
+            Real deta_e = gamma < e.gamma_m ? 0 : -eta_e * (2 - e.p) * gamma_bar / (root * (1 + Y));
+            return std::make_pair(Y * (1 + Y) - ratio * eta_e, 1 + 2 * Y - ratio * deta_e);
+        },
+        0, Y_of(b_max), Y0, 1e-6, iters);
 }
 
 /********************************************************************************************************************
  * FUNCTION: genICPhotons
  * DESCRIPTION: Generates a grid of ICPhoton objects (ICPhotonGrid) from the provided SynElectronGrid and
  *              SynPhotonGrid. For each grid cell, it calls the gen() method of the ICPhoton to compute the IC
- *              photon spectrum based on the local electron and synchrotron photon properties.
+ *              photon spectrum based on the local electron and synchrotron photon properties. The cells are
+ *              distributed over the pool, and every thread reuses its own scratch IntegratorGrid.
  ********************************************************************************************************************/
-ICPhotonGrid genICPhotons(SynElectronGrid const& e, SynPhotonGrid const& ph) {
+ICPhotonGrid genICPhotons(SynElectronGrid const& e, SynPhotonGrid const& ph, ThreadPool* pool) {
     size_t phi_size = e.shape()[0];
     size_t theta_size = e.shape()[1];
     size_t r_size = e.shape()[2];
     ICPhotonGrid IC_ph = createICPhotonGrid(phi_size, theta_size, r_size);
 
-    for (size_t i = 0; i < phi_size; ++i) {
-        for (size_t j = 0; j < theta_size; ++j) {
-            for (size_t k = 0; k < r_size; ++k) {
-                // Generate the IC photon spectrum for each grid cell.
-                IC_ph[i][j][k].gen(e[i][j][k], ph[i][j][k]);
-            }
-        }
-    }
+    PerThread<IntegratorGrid> scratch(pool);
+
+    parallelForCells(pool, phi_size, theta_size, r_size, [&](size_t i, size_t j, size_t k) {
+        // Generate the IC photon spectrum for each grid cell.
+        IC_ph[i][j][k].gen(e[i][j][k], ph(i, j, k), scratch.local());
+    });
     return IC_ph;
 }
 
@@ -95,24 +208,37 @@ ICPhotonGrid genICPhotons(SynElectronGrid const& e, SynPhotonGrid const& ph) {
  * DESCRIPTION: Applies electron cooling in the Thomson regime.
  *              For each cell in the SynElectronGrid, it computes the effective Y parameter using effectiveYThomson,
  *              clears the current inverse Compton Y parameters (Ys), and stores the computed Y_T.
- *              Finally, it updates the electrons based on the new Y parameter.
+ *              Finally, it updates the electrons based on the new Y parameter. Along each shell, the Y solver starts
+ *              from the Y of the previous cells (see shellGuess). If stats is not null, the solver work is added to
+ *              it.
  ********************************************************************************************************************/
-void eCoolingThomson(SynElectronGrid& e, SynPhotonGrid const& ph, Shock const& shock) {
+void eCoolingThomson(SynElectronGrid& e, SynPhotonGrid const& ph, Shock const& shock, ThreadPool* pool,
+                     SolverStats* stats) {
     size_t phi_size = e.shape()[0];
     size_t theta_size = e.shape()[1];
     size_t r_size = e.shape()[2];
 
-    for (size_t i = 0; i < phi_size; i++) {
-        for (size_t j = 0; j < theta_size; ++j) {
+    PerThread<SolverStats> solver_stats(pool);
+
+    parallelForShells(
+        pool, phi_size, theta_size,
+        [&](size_t i, size_t j) {
+            SolverStats& work = solver_stats.local();
+            Real Y_prev[2] = {0, 0};  // Solutions at k-1 and k-2
             for (size_t k = 0; k < r_size; ++k) {
-                Real Y_T =
-                    effectiveYThomson(shock.B[i][j][k], shock.t_com[i][j][k], shock.eps_e, shock.eps_B, e[i][j][k]);
+                Real Y_T = effectiveYThomson(shock.B[i][j][k], shock.t_com[i][j][k], shock.eps_e, shock.eps_B,
+                                             e[i][j][k], shellGuess(Y_prev[0], Y_prev[1]), &work.Y);
+                Y_prev[1] = std::exchange(Y_prev[0], Y_T);
 
                 e[i][j][k].Ys = InverseComptonY(Y_T);
             }
-        }
+        },
+        {Schedule::Dynamic});  // effectiveYThomson iterates to convergence, so the shell cost is uneven.
+
+    if (stats != nullptr) {
+        solver_stats.forEach([stats](SolverStats const& work) { *stats += work; });
     }
-    updateElectrons4Y(e, shock);
+    updateElectrons4Y(e, shock, pool, stats);
 }
 
 /********************************************************************************************************************
@@ -121,21 +247,34 @@ void eCoolingThomson(SynElectronGrid& e, SynPhotonGrid const& ph, Shock const& s
  *              Similar to eCoolingThomson, but for each cell, it creates an InverseComptonY object with additional
  *              parameters from the synchrotron photon grid.
  ********************************************************************************************************************/
-void eCoolingKleinNishina(SynElectronGrid& e, SynPhotonGrid const& ph, Shock const& shock) {
+void eCoolingKleinNishina(SynElectronGrid& e, SynPhotonGrid const& ph, Shock const& shock, ThreadPool* pool,
+                          SolverStats* stats) {
     size_t phi_size = e.shape()[0];
     size_t theta_size = e.shape()[1];
     size_t r_size = e.shape()[2];
-    for (size_t i = 0; i < phi_size; ++i) {
-        for (size_t j = 0; j < theta_size; ++j) {
+
+    PerThread<SolverStats> solver_stats(pool);
+
+    parallelForShells(
+        pool, phi_size, theta_size,
+        [&](size_t i, size_t j) {
+            SolverStats& work = solver_stats.local();
+            Real Y_prev[2] = {0, 0};  // Solutions at k-1 and k-2
             for (size_t k = 0; k < r_size; ++k) {
-                Real Y_T =
-                    effectiveYThomson(shock.B[i][j][k], shock.t_com[i][j][k], shock.eps_e, shock.eps_B, e[i][j][k]);
-                // Clear existing Ys and emplace a new InverseComptonY with additional synchrotron frequency parameters.
+                Real Y_T = effectiveYThomson(shock.B[i][j][k], shock.t_com[i][j][k], shock.eps_e, shock.eps_B,
+                                             e[i][j][k], shellGuess(Y_prev[0], Y_prev[1]), &work.Y);
+                Y_prev[1] = std::exchange(Y_prev[0], Y_T);
+                // Clear existing Ys and emplace a new InverseComptonY with additional synchrotron frequency
+                // parameters.
                 // e[i][j][k].Ys.clear();
                 // e[i][j][k].Ys.emplace_back(ph[i][j][k].nu_m, ph[i][j][k].nu_c, shock.B[i][j][k], Y_T);
-                e[i][j][k].Ys = InverseComptonY(ph[i][j][k].nu_m, ph[i][j][k].nu_c, shock.B[i][j][k], Y_T);
+                e[i][j][k].Ys = InverseComptonY(ph.nu_m[i][j][k], ph.nu_c[i][j][k], shock.B[i][j][k], Y_T);
             }
-        }
+        },
+        {Schedule::Dynamic});
+
+    if (stats != nullptr) {
+        solver_stats.forEach([stats](SolverStats const& work) { *stats += work; });
     }
-    updateElectrons4Y(e, shock);
-}
\ No newline at end of file
+    updateElectrons4Y(e, shock, pool, stats);
+}
@@ -7,7 +7,10 @@
 
 #include "synchrotron.h"
 
+#include <algorithm>
 #include <cmath>
+#include <numbers>
+#include <utility>
 
 #include "afterglow.h"
 #include "inverse-compton.h"
@@ -91,6 +94,53 @@ Real InverseComptonY::as_gamma(Real gamma, Real p) const {
     }
 }
 
+/********************************************************************************************************************
+ * FUNCTION: InverseComptonY::as_gamma_slope(Real gamma, Real p) const
+ * DESCRIPTION: Returns the logarithmic slope d log Y / d log gamma of the as_gamma segment that contains gamma.
+ ********************************************************************************************************************/
+Real InverseComptonY::as_gamma_slope(Real gamma, Real p) const {
+    switch (regime) {
+        case 1:
+            if (gamma <= gamma_hat_m) {
+                return 0;
+            } else if (gamma <= gamma_hat_c) {
+                return -0.5;
+            } else
+                return -4. / 3;
+            break;
+        case 2:
+            if (gamma <= gamma_hat_c) {
+                return 0;
+            } else if (gamma <= gamma_hat_m) {
+                return (p - 3) / 2;
+            } else
+                return -4. / 3;
+            break;
+        default:
+            return 0;
+            break;
+    }
+}
+
+/********************************************************************************************************************
+ * FUNCTION: InverseComptonY::Y_max(Real p) const
+ * DESCRIPTION: Returns the maximum of as_gamma over all gamma. The segments of as_gamma are monotonic, so it is
+ *              reached below the first break (Y_T) or, in regime 2 with p > 3, at gamma_hat_m.
+ ********************************************************************************************************************/
+Real InverseComptonY::Y_max(Real p) const {
+    switch (regime) {
+        case 0:
+            return 0;
+            break;
+        case 2:
+            return p > 3 ? as_gamma(gamma_hat_m, p) : Y_T;
+            break;
+        default:
+            return Y_T;
+            break;
+    }
+}
+
 /********************************************************************************************************************
  * FUNCTION: InverseComptonY::as_nu(Real nu, Real p) const
  * DESCRIPTION: Returns the effective Y parameter as a function of frequency (nu) and power-law index (p),
@@ -168,21 +218,330 @@ Real InverseComptonY::Y_tilt_nu(InverseComptonY const& Ys, Real nu, Real p) {
 }
 
 /********************************************************************************************************************
- * FUNCTION: createSynPhotonGrid(size_t phi_size, size_t theta_size, size_t t_size)
- * DESCRIPTION: Creates and returns a SynPhotonGrid with the specified dimensions.
+ * FUNCTION: createCellGrid(size_t phi_size, size_t theta_size, size_t t_size, ThreadPool* pool)
+ * DESCRIPTION: Creates a value-initialized 3D grid of type Grid. With a pool, the shells are first touched by the
+ *              pool threads with the static partition of parallelForShells (see FirstTouchScope).
+ ********************************************************************************************************************/
+template <typename Grid>
+Grid createCellGrid(size_t phi_size, size_t theta_size, size_t t_size, ThreadPool* pool) {
+    FirstTouchScope scope(pool, phi_size * theta_size);
+    return Grid(boost::extents[phi_size][theta_size][t_size]);
+}
+
+/********************************************************************************************************************
+ * CONSTANTS: Spectral segment tables
+ * DESCRIPTION: Per regime (index 1-6; 0 means no emission): the number of spectral segments, the slope
+ *              d log I / d log nu = seg_slope_0 + seg_slope_p * p of each segment, and the index into
+ *              LogSpectrum::log_nu_break of the break each segment is normalized at. The breaks are
+ *              [nu_a, nu_m, nu_c] in regime 1, [nu_m, nu_a, nu_c] in regime 2, [nu_a, nu_c, nu_m] in regime 3,
+ *              [nu_a, nu_m] in regime 4 and [nu_a] in regimes 5 and 6 (Bing Zhang's Book, pages 199-200).
+ ********************************************************************************************************************/
+constexpr size_t seg_num[7] = {1, 4, 4, 4, 3, 2, 2};
+constexpr Real seg_slope_0[7][4] = {{0, 0, 0, 0},    {2, 1. / 3, 0.5, 0}, {2, 2.5, 0.5, 0}, {2, 1. / 3, -0.5, 0},
+                                    {2, -0.5, 0, 0}, {2, 0, 0, 0},        {2, 0, 0, 0}};
+constexpr Real seg_slope_p[7][4] = {{0, 0, 0, 0},    {0, 0, -0.5, -0.5}, {0, 0, -0.5, -0.5}, {0, 0, 0, -0.5},
+                                    {0, 0, -0.5, 0}, {0, -0.5, 0, 0},    {0, -0.5, 0, 0}};
+constexpr size_t seg_ref[7][4] = {{0, 0, 0, 0}, {0, 1, 1, 1}, {0, 1, 0, 0}, {0, 1, 1, 2},
+                                  {0, 0, 1, 0}, {0, 0, 0, 0}, {0, 0, 0, 0}};
+// Per regime, a segment whose log intensity at its reference break is the log peak intensity itself.
+constexpr size_t seg_peak[7] = {0, 1, 2, 1, 0, 0, 0};
+
+/********************************************************************************************************************
+ * FUNCTION: logSpectrum(LogSpectrum const& spec, size_t regime, Real p, Real nu_M, Real log_nu, Real nu)
+ * DESCRIPTION: Evaluates the log synchrotron intensity (without the IC correction) at frequency nu: finds the
+ *              segment of log_nu among the breaks and follows its straight line from the reference break. The
+ *              exponential cutoff -nu / nu_M applies to the last segment.
+ ********************************************************************************************************************/
+inline Real logSpectrum(LogSpectrum const& spec, size_t regime, Real p, Real nu_M, Real log_nu, Real nu) {
+    if (regime == 0 || regime > 6) {
+        return -con::inf;
+    }
+    size_t s = 0;
+    while (s < 3 && log_nu > spec.log_nu_break[s]) {
+        s++;
+    }
+    Real slope = seg_slope_0[regime][s] + seg_slope_p[regime][s] * p;
+    Real log_I = spec.log_I[s] + slope * (log_nu - spec.log_nu_break[seg_ref[regime][s]]);
+    if (s + 1 == seg_num[regime]) {
+        log_I -= nu / nu_M;
+    }
+    return log_I;
+}
+
+/********************************************************************************************************************
+ * FUNCTION: cutoffIntegral(Real log_I, Real slope, Real log_nu_1, Real log_nu_2, Real nu_M)
+ * DESCRIPTION: Closed-form integral over [nu_1, nu_2] of the power law exp(log_I + slope (log nu - log_nu_1)) times
+ *              the cutoff exp(-nu / nu_M). With x = nu / nu_M and s = slope + 1 it is exp(log_I) nu_1 times
+ *              G = x_1^-s (Gamma(s, x_1) - Gamma(s, x_2)), from the series of the incomplete gamma function for x < 1
+ *              and from its continued fraction (modified Lentz) for x >= 1; the interval must lie on one side of
+ *              x = 1. Both work for any s < 1, which holds for every last segment (slope -p/2).
+ ********************************************************************************************************************/
+inline Real cutoffIntegral(Real log_I, Real slope, Real log_nu_1, Real log_nu_2, Real nu_M) {
+    constexpr Real eps = 1e-16;
+    Real s = slope + 1;
+    Real log_r = log_nu_2 - log_nu_1;
+    Real r_s = std::exp(s * log_r);  // (x_2 / x_1)^s
+    Real x_1 = std::exp(log_nu_1) / nu_M;
+    Real x_2 = std::exp(log_nu_2) / nu_M;
+    Real G = 0;
+    if (x_1 * x_2 < 1) {
+        // Sum of (-1)^n / n! (x_2^(s+n) - x_1^(s+n)) / (s + n), divided by x_1^s.
+        Real x_1n = 1, x_2n = 1, sign_fact = 1;  // x_1^n, x_2^n, (-1)^n / n!
+        for (size_t n = 0; n < 64; ++n) {
+            Real q = s + n;
+            Real term = std::abs(q * log_r) < 1 ? x_1n * (q == 0 ? log_r : std::expm1(q * log_r) / q)
+                                                : (x_2n * r_s - x_1n) / q;
+            G += sign_fact * term;
+            if (std::abs(term * sign_fact) <= eps * std::abs(G)) {
+                break;
+            }
+            x_1n *= x_1;
+            x_2n *= x_2;
+            sign_fact /= -Real(n + 1);
+        }
+    } else {
+        // Gamma(s, x) = exp(-x) x^s h(x) with h the continued fraction 1 / (x + 1 - s - 1 (1 - s) / (x + 3 - s - ...)).
+        auto h = [s](Real x) {
+            constexpr Real tiny = 1e-300;
+            Real b = x + 1 - s;
+            Real c = 1 / tiny;
+            Real d = 1 / b;
+            Real h = d;
+            for (size_t i = 1; i < 200; ++i) {
+                Real a = -Real(i) * (i - s);
+                b += 2;
+                d = a * d + b;
+                d = std::abs(d) < tiny ? tiny : d;
+                c = b + a / c;
+                c = std::abs(c) < tiny ? tiny : c;
+                d = 1 / d;
+                h *= d * c;
+                if (std::abs(d * c - 1) <= eps) {
+                    break;
+                }
+            }
+            return h;
+        };
+        G = std::exp(-x_1) * h(x_1) - (x_2 < 745 ? std::exp(-x_2) * r_s * h(x_2) : 0);
+    }
+    return std::exp(log_I + log_nu_1) * G;
+}
+
+/********************************************************************************************************************
+ * FUNCTION: bandSpectrum(LogSpectrum const& spec, size_t regime, Real p, Real nu_M, Real nu_c, Real Y_c,
+ *                        InverseComptonY const& Ys, Real nu_lo, Real nu_hi)
+ * DESCRIPTION: Integral over [nu_lo, nu_hi] of the intensity of log_I_nu (synchrotron spectrum with the IC
+ *              correction). The band is cut at the spectral breaks, nu_M, nu_c and, with IC, at nu_hat_m and
+ *              nu_hat_c, so that every piece lies in one segment and on one side of each kink. A piece is then a
+ *              power law (closed form, see powerLawIntegral), a power law times the cutoff exp(-nu / nu_M) (closed
+ *              form, see cutoffIntegral), or, where the Klein-Nishina correction (1 + Y_c) / (1 + Y(nu)) varies, a
+ *              smooth function that is integrated by 4-point Gauss-Legendre quadrature on sub-pieces of one
+ *              e-fold in nu (relative error below 1e-6; the cutoff is cut off at 50 nu_M there).
+ ********************************************************************************************************************/
+Real bandSpectrum(LogSpectrum const& spec, size_t regime, Real p, Real nu_M, Real nu_c, Real Y_c,
+                  InverseComptonY const& Ys, Real nu_lo, Real nu_hi) {
+    if (regime == 0 || regime > 6 || !(nu_hi > nu_lo)) {
+        return 0;
+    }
+    Real log_lo = std::log(nu_lo);
+    Real log_hi = std::log(nu_hi);
+
+    Real cuts[9];
+    size_t cut_num = 0;
+    auto addCut = [&](Real log_nu) {
+        if (log_nu > log_lo && log_nu < log_hi) {
+            cuts[cut_num++] = log_nu;
+        }
+    };
+    cuts[cut_num++] = log_lo;
+    for (Real log_nu_break : spec.log_nu_break) {
+        addCut(log_nu_break);
+    }
+    addCut(std::log(nu_M));
+    addCut(std::log(nu_c));
+    if (Ys.regime != 0) {
+        addCut(std::log(Ys.nu_hat_m));
+        addCut(std::log(Ys.nu_hat_c));
+    }
+    cuts[cut_num++] = log_hi;
+    std::sort(cuts, cuts + cut_num);
+
+    auto IC_factor = [&](Real nu) { return (1 + Y_c) / (1 + InverseComptonY::Y_tilt_nu(Ys, nu, p)); };
+
+    Real I = 0;
+    for (size_t c = 0; c + 1 < cut_num; ++c) {
+        Real log_nu_1 = cuts[c];
+        Real log_nu_2 = cuts[c + 1];
+        if (!(log_nu_2 > log_nu_1)) {
+            continue;
+        }
+        Real log_nu_mid = 0.5 * (log_nu_1 + log_nu_2);
+        size_t s = 0;
+        while (s < 3 && log_nu_mid > spec.log_nu_break[s]) {
+            s++;
+        }
+        Real slope = seg_slope_0[regime][s] + seg_slope_p[regime][s] * p;
+        Real log_I = spec.log_I[s] + slope * (log_nu_1 - spec.log_nu_break[seg_ref[regime][s]]);
+        bool cutoff = (s + 1 == seg_num[regime]);
+
+        if (std::exp(log_nu_mid) >= nu_c) {
+            Real f_1 = IC_factor(std::exp(log_nu_1));
+            if (f_1 != IC_factor(std::exp(log_nu_2))) {
+                // Gauss-Legendre quadrature of nu I(nu) over log nu.
+                constexpr Real node[4] = {-0.8611363115940526, -0.3399810435848563, 0.3399810435848563,
+                                          0.8611363115940526};
+                constexpr Real weight[4] = {0.3478548451374538, 0.6521451548625461, 0.6521451548625461,
+                                            0.3478548451374538};
+                if (cutoff) {
+                    log_nu_2 = std::min(log_nu_2, std::log(50 * nu_M));
+                }
+                if (!(log_nu_2 > log_nu_1)) {
+                    continue;
+                }
+                size_t sub_num = static_cast<size_t>(std::max(1., std::ceil(log_nu_2 - log_nu_1)));
+                Real half = 0.5 * (log_nu_2 - log_nu_1) / sub_num;
+                for (size_t m = 0; m < sub_num; ++m) {
+                    Real center = log_nu_1 + (2 * m + 1) * half;
+                    for (size_t g = 0; g < 4; ++g) {
+                        Real log_nu = center + half * node[g];
+                        Real nu = std::exp(log_nu);
+                        Real log_I_nu = log_I + slope * (log_nu - log_nu_1) - (cutoff ? nu / nu_M : 0);
+                        I += weight[g] * half * nu * std::exp(log_I_nu) * IC_factor(nu);
+                    }
+                }
+                continue;
+            }
+            log_I += std::log(f_1);
+        }
+        I += cutoff ? cutoffIntegral(log_I, slope, log_nu_1, log_nu_2, nu_M)
+                    : powerLawIntegral(log_I, slope, log_nu_1, log_nu_2);
+    }
+    return I;
+}
+
+/********************************************************************************************************************
+ * CONSTRUCTOR: SynPhotonGrid::SynPhotonGrid
+ * DESCRIPTION: Constructs a SynPhotonGrid with the specified dimensions. With a thread pool, the arrays are first
+ *              touched by the pool threads (see FirstTouchScope).
+ ********************************************************************************************************************/
+SynPhotonGrid::SynPhotonGrid(size_t phi_size, size_t theta_size, size_t t_size, ThreadPool* pool)
+    : nu_m(createStorage3DGrid(phi_size, theta_size, t_size, pool)),
+      nu_c(createStorage3DGrid(phi_size, theta_size, t_size, pool)),
+      nu_a(createStorage3DGrid(phi_size, theta_size, t_size, pool)),
+      nu_M(createStorage3DGrid(phi_size, theta_size, t_size, pool)),
+      p(createStorage3DGrid(phi_size, theta_size, t_size, pool)),
+      Y_c(createStorage3DGrid(phi_size, theta_size, t_size, pool)),
+      regime(createCellGrid<decltype(regime)>(phi_size, theta_size, t_size, pool)),
+      Ys(createCellGrid<decltype(Ys)>(phi_size, theta_size, t_size, pool)),
+      log_spec(createCellGrid<decltype(log_spec)>(phi_size, theta_size, t_size, pool)),
+      phi_size(phi_size),
+      theta_size(theta_size),
+      t_size(t_size) {}
+
+/********************************************************************************************************************
+ * METHOD: SynPhotonGrid::operator()(size_t i, size_t j, size_t k) const
+ * DESCRIPTION: Gathers the photons of cell (i, j, k) into a SynPhotons. The peak intensity is read back from the
+ *              spectrum segment normalized to it (see seg_peak).
+ ********************************************************************************************************************/
+SynPhotons SynPhotonGrid::operator()(size_t i, size_t j, size_t k) const {
+    size_t idx = offset(i, j, k);
+    SynPhotons ph;
+    ph.nu_m = nu_m.data()[idx];
+    ph.nu_c = nu_c.data()[idx];
+    ph.nu_a = nu_a.data()[idx];
+    ph.nu_M = nu_M.data()[idx];
+    ph.p = p.data()[idx];
+    ph.Y_c = Y_c.data()[idx];
+    ph.regime = regime.data()[idx];
+    ph.Ys = Ys.data()[idx];
+    ph.log_spec_ = log_spec.data()[idx];
+    ph.I_nu_peak = std::exp(ph.log_spec_.log_I[seg_peak[ph.regime]]);
+    return ph;
+}
+
+/********************************************************************************************************************
+ * METHOD: SynPhotonGrid::set(size_t i, size_t j, size_t k, SynPhotons const& ph)
+ * DESCRIPTION: Scatters a SynPhotons into the arrays of cell (i, j, k).
  ********************************************************************************************************************/
-SynPhotonGrid createSynPhotonGrid(size_t phi_size, size_t theta_size, size_t t_size) {
-    SynPhotonGrid grid(boost::extents[phi_size][theta_size][t_size]);
-    return grid;
+void SynPhotonGrid::set(size_t i, size_t j, size_t k, SynPhotons const& ph) {
+    size_t idx = offset(i, j, k);
+    nu_m.data()[idx] = ph.nu_m;
+    nu_c.data()[idx] = ph.nu_c;
+    nu_a.data()[idx] = ph.nu_a;
+    nu_M.data()[idx] = ph.nu_M;
+    p.data()[idx] = ph.p;
+    Y_c.data()[idx] = ph.Y_c;
+    regime.data()[idx] = ph.regime;
+    Ys.data()[idx] = ph.Ys;
+    log_spec.data()[idx] = ph.log_spec_;
 }
 
 /********************************************************************************************************************
- * FUNCTION: createSynElectronGrid(size_t phi_size, size_t theta_size, size_t t_size)
- * DESCRIPTION: Creates and returns a SynElectronGrid with the specified dimensions.
+ * METHOD: SynPhotonGrid::I_nu(size_t i, size_t j, size_t k, Real nu) const
+ * DESCRIPTION: Computes the synchrotron photon intensity of cell (i, j, k) at frequency nu (see SynPhotons::I_nu).
  ********************************************************************************************************************/
-SynElectronGrid createSynElectronGrid(size_t phi_size, size_t theta_size, size_t t_size) {
-    SynElectronGrid grid(boost::extents[phi_size][theta_size][t_size]);
-    return grid;
+Real SynPhotonGrid::I_nu(size_t i, size_t j, size_t k, Real nu) const {
+    return fastExp(log_I_nu(i, j, k, fastLog(nu), nu));
+}
+
+/********************************************************************************************************************
+ * METHOD: SynPhotonGrid::log_I_nu(size_t i, size_t j, size_t k, Real log_nu, Real nu) const
+ * DESCRIPTION: Computes the log synchrotron photon intensity of cell (i, j, k) at frequency nu (see
+ *              SynPhotons::log_I_nu). Only the arrays the spectrum needs are read: the segments and p, nu_M for the
+ *              last segment, and the IC parameters only above the cooling frequency.
+ ********************************************************************************************************************/
+Real SynPhotonGrid::log_I_nu(size_t i, size_t j, size_t k, Real log_nu, Real nu) const {
+    size_t idx = offset(i, j, k);
+    Real p_ = p.data()[idx];
+    Real log_I = logSpectrum(log_spec.data()[idx], regime.data()[idx], p_, nu_M.data()[idx], log_nu, nu);
+    if (nu < nu_c.data()[idx]) {
+        return log_I;
+    } else {
+        return log_I + fastLog((1 + Y_c.data()[idx]) / (1 + InverseComptonY::Y_tilt_nu(Ys.data()[idx], nu, p_)));
+    }
+}
+
+/********************************************************************************************************************
+ * METHOD: SynPhotonGrid::I_nu_band(size_t i, size_t j, size_t k, Real nu_lo, Real nu_hi) const
+ * DESCRIPTION: Integrates the intensity of cell (i, j, k) over the band [nu_lo, nu_hi] (see SynPhotons::I_nu_band).
+ ********************************************************************************************************************/
+Real SynPhotonGrid::I_nu_band(size_t i, size_t j, size_t k, Real nu_lo, Real nu_hi) const {
+    size_t idx = offset(i, j, k);
+    return bandSpectrum(log_spec.data()[idx], regime.data()[idx], p.data()[idx], nu_M.data()[idx], nu_c.data()[idx],
+                        Y_c.data()[idx], Ys.data()[idx], nu_lo, nu_hi);
+}
+
+/********************************************************************************************************************
+ * METHOD: SynPhotonGrid::log_I_nu(size_t i, size_t j, size_t k, Real const* log_nu, Real const* nu, size_t n,
+ *                                 Real* log_I) const
+ * DESCRIPTION: The single-frequency log_I_nu at n frequencies, with the cell's entries read once. Every value is
+ *              computed exactly as by the single-frequency method.
+ ********************************************************************************************************************/
+void SynPhotonGrid::log_I_nu(size_t i, size_t j, size_t k, Real const* log_nu, Real const* nu, size_t n,
+                             Real* log_I) const {
+    size_t idx = offset(i, j, k);
+    LogSpectrum const& spec = log_spec.data()[idx];
+    size_t regime_ = regime.data()[idx];
+    Real p_ = p.data()[idx];
+    Real nu_M_ = nu_M.data()[idx];
+    Storage nu_c_ = nu_c.data()[idx];
+    InverseComptonY const& Ys_ = Ys.data()[idx];
+    Storage Y_c_ = Y_c.data()[idx];
+    for (size_t l = 0; l < n; ++l) {
+        log_I[l] = logSpectrum(spec, regime_, p_, nu_M_, log_nu[l], nu[l]);
+        if (nu[l] >= nu_c_) {
+            log_I[l] += fastLog((1 + Y_c_) / (1 + InverseComptonY::Y_tilt_nu(Ys_, nu[l], p_)));
+        }
+    }
+}
+
+/********************************************************************************************************************
+ * FUNCTION: createSynElectronGrid(size_t phi_size, size_t theta_size, size_t t_size, ThreadPool* pool)
+ * DESCRIPTION: Creates and returns a SynElectronGrid with the specified dimensions. With a thread pool, the grid memory
+ *              is first touched by the pool threads (see FirstTouchScope).
+ ********************************************************************************************************************/
+SynElectronGrid createSynElectronGrid(size_t phi_size, size_t theta_size, size_t t_size, ThreadPool* pool) {
+    return createCellGrid<SynElectronGrid>(phi_size, theta_size, t_size, pool);
 }
 
 /********************************************************************************************************************
@@ -292,129 +651,85 @@ Real SynElectrons::gammaSpectrum(Real gamma) const {
  * DESCRIPTION: Computes the synchrotron photon intensity at frequency nu based on the electron peak intensity
  *              and the computed spectrum. Adjusts for inverse Compton effects if nu exceeds nu_c.
  ********************************************************************************************************************/
-Real SynPhotons::I_nu(Real nu) const {
+Real SynPhotons::I_nu(Real nu) const { return fastExp(log_I_nu(fastLog(nu), nu)); }
+
+/********************************************************************************************************************
+ * FUNCTION: SynPhotons::log_I_nu(Real log_nu, Real nu) const
+ * DESCRIPTION: Computes the log synchrotron photon intensity at frequency nu from the log-domain spectrum: a segment
+ *              lookup and a multiply-add, plus the cutoff in the last segment. Adjusts for inverse Compton effects if
+ *              nu exceeds nu_c. Returns -inf where the intensity is zero.
+ ********************************************************************************************************************/
+Real SynPhotons::log_I_nu(Real log_nu, Real nu) const {
+    Real log_I = logSpectrum(log_spec_, regime, p, nu_M, log_nu, nu);
     if (nu < nu_c) {
-        return e->I_nu_peak * spectrum(nu);  // Below cooling frequency, simple scaling
+        return log_I;  // Below cooling frequency, simple scaling
     } else {
-        return e->I_nu_peak * spectrum(nu) * (1 + e->Y_c) / (1 + InverseComptonY::Y_tilt_nu(e->Ys, nu, e->p));
+        return log_I + fastLog((1 + Y_c) / (1 + InverseComptonY::Y_tilt_nu(Ys, nu, p)));
         // Above cooling frequency, include inverse Compton correction
     }
 }
 
+/********************************************************************************************************************
+ * FUNCTION: SynPhotons::I_nu_band(Real nu_lo, Real nu_hi) const
+ * DESCRIPTION: Integrates I_nu over the band [nu_lo, nu_hi] (see bandSpectrum). The spectrum is a broken power law,
+ *              so this is exact except where the Klein-Nishina IC correction varies within the band.
+ ********************************************************************************************************************/
+Real SynPhotons::I_nu_band(Real nu_lo, Real nu_hi) const {
+    return bandSpectrum(log_spec_, regime, p, nu_M, nu_c, Y_c, Ys, nu_lo, nu_hi);
+}
+
 /********************************************************************************************************************
  * FUNCTION: SynPhotons::updateConstant()
- * DESCRIPTION: Updates internal constants used for computing the synchrotron photon spectrum based on the
- *              current spectral parameters from the associated electrons.
+ * DESCRIPTION: Precomputes the log-domain spectrum from the current spectral parameters: the log breaks and the log
+ *              intensity of every segment at its reference break (see the segment tables), including the peak
+ *              intensity. A spectrum segment C * (nu / nu_ref)^slope becomes log I_nu_peak + log C + slope * log(nu /
+ *              nu_ref).
  ********************************************************************************************************************/
 void SynPhotons::updateConstant() {
-    // Update constants based on spectral parameters
-    Real p = e->p;
-    if (e->regime == 1) {
-        // a_m_1_3 = std::cbrt(nu_a / nu_m);  // (nu_a / nu_m)^(1/3)
-        // c_m_1_2 = std::sqrt(nu_c / nu_m);  // (nu_c / nu_m)^(1/2)
-        C1_ = std::cbrt(nu_a / nu_m);
-        C2_ = std::sqrt(nu_c / nu_m);
-    } else if (e->regime == 2) {
-        // m_a_pa4_2 = fastPow(nu_m / nu_a, (p + 4) / 2);    // (nu_m / nu_a)^((p+4)/2)
-        // a_m_mpa1_2 = fastPow(nu_a / nu_m, (-p + 1) / 2);  // (nu_a / nu_m)^((-p+1)/2)
-        // c_m_1_2 = std::sqrt(nu_c / nu_m);
-        C1_ = fastPow(nu_m / nu_a, (p + 4) / 2);
-        C2_ = fastPow(nu_a / nu_m, (-p + 1) / 2);
-        C3_ = std::sqrt(nu_c / nu_m);
-    } else if (e->regime == 3) {
-        // a_c_1_3 = std::cbrt(nu_a / nu_c);  // (nu_a / nu_c)^(1/3)
-        // c_m_1_2 = std::sqrt(nu_c / nu_m);  // (nu_c / nu_m)^(1/2)
-        C1_ = std::cbrt(nu_a / nu_c);
-        C2_ = std::sqrt(nu_c / nu_m);
-    } else if (e->regime == 4) {
-        // a_m_1_2 = std::sqrt(nu_a / nu_m);  // (nu_a / nu_m)^(1/2)
-        // R4 = std::sqrt(nu_c / nu_a) / 3;   // (nu_c / nu_a)^(1/2) / 3; // R4: scaling factor for regime 4
-        C1_ = std::sqrt(nu_a / nu_m);
-        C2_ = std::sqrt(nu_c / nu_a) / 3;
-    } else if (e->regime == 5 || e->regime == 6) {
-        // R4 = std::sqrt(nu_c / nu_a) / 3;              // (nu_c / nu_a)^(1/2) / 3; // R4: scaling factor for regime 4
-        // R6 = R4 * fastPow(nu_m / nu_a, (p - 1) / 2);  // R6: scaling factor for regime 6
-        C1_ = std::sqrt(nu_c / nu_a) / 3;
-        C2_ = C1_ * fastPow(nu_m / nu_a, (p - 1) / 2);
-    }
-    // R5 = (p - 1) * R6;  // R5 scales R6 (commented out)
-}
-
-/********************************************************************************************************************
- * FUNCTION: SynPhotons::spectrum(Real nu) const
- * DESCRIPTION: Computes the synchrotron photon spectrum at frequency nu based on the regime of the associated
- *              electrons. Different formulae apply in each regime.
- ********************************************************************************************************************/
-Real SynPhotons::spectrum(Real nu) const {
-    Real p = e->p;
-    switch (e->regime) {
-        case 1:
-            if (nu <= nu_a) {
-                return C1_ * (nu / nu_a) * (nu / nu_a);
-            }
-            if (nu <= nu_m) {
-                return std::cbrt(nu / nu_m);
-            }
-            if (nu <= nu_c) {
-                return fastPow(nu / nu_m, -(p - 1) / 2);
-            }
-            return C2_ * fastPow(nu / nu_m, -p / 2) * fastExp(-nu / nu_M);
-
-            break;
-        case 2:
-            if (nu <= nu_m) {
-                return C1_ * (nu / nu_m) * (nu / nu_m);
-            }
-            if (nu <= nu_a) {
-                return C2_ * pow52(nu / nu_a);  // Using pow52 for (nu / nu_a)^(5/2)
-            }
-            if (nu <= nu_c) {
-                return fastPow(nu / nu_m, -(p - 1) / 2);
-            }
-            return C3_ * fastPow(nu / nu_m, -p / 2) * fastExp(-nu / nu_M);
-
-            break;
-        case 3:
-            if (nu <= nu_a) {
-                return C1_ * (nu / nu_a) * (nu / nu_a);
-            }
-            if (nu <= nu_c) {
-                return std::cbrt(nu / nu_c);
-            }
-            if (nu <= nu_m) {
-                return std::sqrt(nu_c / nu);
-            }
-            return C2_ * fastPow(nu / nu_m, -p / 2) * fastExp(-nu / nu_M);
-
-            break;
-        case 4:
-            if (nu <= nu_a) {
-                return (nu / nu_a) * (nu / nu_a);
-            }
-            if (nu <= nu_m) {
-                return C2_ * std::sqrt(nu_a / nu);
-            }
-            return C2_ * C1_ * fastPow(nu / nu_m, -p / 2) * fastExp(-nu / nu_M);
-
-            break;
-        case 5:
-            if (nu <= nu_a) {
-                return (nu / nu_a) * (nu / nu_a);
-            }
-            return (p - 1) * C2_ * fastPow(nu / nu_a, -p / 2) * fastExp(-nu / nu_M);
-
-            break;
-        case 6:
-            if (nu <= nu_a) {
-                return (nu / nu_a) * (nu / nu_a);
-            }
-            return C2_ * fastPow(nu / nu_a, -p / 2) * fastExp(-nu / nu_M);
-
-            break;
+    Real log_a = fastLog(nu_a);
+    Real log_m = fastLog(nu_m);
+    Real log_c = fastLog(nu_c);
+
+    log_spec_ = LogSpectrum{};
+    Real* brk = log_spec_.log_nu_break;
+    Real* L = log_spec_.log_I;
+    if (regime == 1) {
+        brk[0] = log_a, brk[1] = log_m, brk[2] = log_c;
+        L[0] = (log_a - log_m) / 3;  // (nu_a / nu_m)^(1/3)
+        L[1] = 0;
+        L[2] = 0;
+        L[3] = (log_c - log_m) / 2;  // (nu_c / nu_m)^(1/2)
+    } else if (regime == 2) {
+        brk[0] = log_m, brk[1] = log_a, brk[2] = log_c;
+        L[0] = (p + 4) / 2 * (log_m - log_a);   // (nu_m / nu_a)^((p+4)/2)
+        L[1] = (-p + 1) / 2 * (log_a - log_m);  // (nu_a / nu_m)^((-p+1)/2)
+        L[2] = 0;
+        L[3] = (log_c - log_m) / 2;  // (nu_c / nu_m)^(1/2)
+    } else if (regime == 3) {
+        brk[0] = log_a, brk[1] = log_c, brk[2] = log_m;
+        L[0] = (log_a - log_c) / 3;  // (nu_a / nu_c)^(1/3)
+        L[1] = 0;
+        L[2] = 0;
+        L[3] = (log_c - log_m) / 2;  // (nu_c / nu_m)^(1/2)
+    } else if (regime == 4) {
+        brk[0] = log_a, brk[1] = log_m;
+        L[0] = 0;
+        L[1] = (log_c - log_a) / 2 - std::log(3.);  // R4 = (nu_c / nu_a)^(1/2) / 3
+        L[2] = L[1] + (log_a - log_m) / 2;          // R4 * (nu_a / nu_m)^(1/2)
+    } else if (regime == 5 || regime == 6) {
+        brk[0] = log_a;
+        L[0] = 0;
+        L[1] = (log_c - log_a) / 2 - std::log(3.) + (p - 1) / 2 * (log_m - log_a);  // R6 = R4 * (nu_m / nu_a)^((p-1)/2)
+        if (regime == 5) {
+            L[1] += fastLog(p - 1);  // R5 = (p - 1) * R6
+        }
+    } else {
+        return;
+    }
 
-        default:
-            return 0;
-            break;
+    Real log_I_peak = fastLog(I_nu_peak);
+    for (size_t s = 0; s < seg_num[regime]; ++s) {
+        L[s] += log_I_peak;
     }
 }
 
@@ -445,33 +760,49 @@ Real syn_gamma(Real nu, Real B) {
 }
 
 /********************************************************************************************************************
- * FUNCTION: syn_gamma_M(Real B, std::vector<InverseComptonY> const& Ys, Real p)
- * DESCRIPTION: Computes the maximum electron Lorentz factor (gamma_M) for synchrotron emission, iterating until
- *              the inverse Compton Y parameter converges.
+ * FUNCTION: syn_gamma_M(Real B, InverseComptonY const& Ys, Real p, Real guess, size_t* iters)
+ * DESCRIPTION: Computes the maximum electron Lorentz factor gamma_M = sqrt(6 pi e / (sigma_T B (1 + Y(gamma_M)))).
+ *              If Y does not depend on gamma, this is closed form. Otherwise, the self-consistent Y is found with
+ *              rootNewton on Y - Y(gamma_M(Y)), which increases with Y (the steepest as_gamma segment has slope
+ *              -4/3 and d log gamma_M / dY = -1 / (2 (1 + Y))), bracketed by [0, Y_max]. guess is the gamma_M of a
+ *              neighbouring cell; the Y it implies is the starting point.
  ********************************************************************************************************************/
-Real syn_gamma_M(Real B, InverseComptonY const& Ys, Real p) {
+Real syn_gamma_M(Real B, InverseComptonY const& Ys, Real p, Real guess, size_t* iters) {
     if (B == 0) {
         return std::numeric_limits<Real>::infinity();
     }
-    Real Y0 = InverseComptonY::Y_Thompson(Ys);
-    Real gamma_M = std::sqrt(6 * con::pi * con::e / (con::sigmaT * B * (1 + Y0)));
-    Real Y1 = InverseComptonY::Y_tilt_gamma(Ys, gamma_M, p);
+    auto gamma_M = [=](Real Y) { return std::sqrt(6 * con::pi * con::e / (con::sigmaT * B * (1 + Y))); };
 
-    for (; std::abs((Y1 - Y0) / Y0) > 1e-5;) {
-        gamma_M = std::sqrt(6 * con::pi * con::e / (con::sigmaT * B * (1 + Y1)));
-        Y0 = Y1;
-        Y1 = InverseComptonY::Y_tilt_gamma(Ys, gamma_M, p);
+    Real Y_T = InverseComptonY::Y_Thompson(Ys);
+    if (Ys.regime != 1 && Ys.regime != 2) {
+        return gamma_M(Y_T);
     }
 
-    return gamma_M;
+    // Start from the Y of the guess (or of the Thomson solution), one more evaluation of Y.
+    Real Y0 = InverseComptonY::Y_tilt_gamma(Ys, guess > 0 ? guess : gamma_M(Y_T), p);
+    if (iters != nullptr) {
+        ++*iters;
+    }
+    Real Y = rootNewton(
+        [&](Real Y) {
+            Real gamma = gamma_M(Y);
+            Real Y_gamma = InverseComptonY::Y_tilt_gamma(Ys, gamma, p);
+            return std::make_pair(Y - Y_gamma, 1 + Y_gamma * Ys.as_gamma_slope(gamma, p) / (2 * (1 + Y)));
+        },
+        0, Ys.Y_max(p), Y0, 1e-6, iters);
+    return gamma_M(Y);
 }
 
 /********************************************************************************************************************
- * FUNCTION: syn_gamma_m(Real Gamma_rel, Real gamma_M, Real eps_e, Real p, Real xi)
+ * FUNCTION: syn_gamma_m(Real Gamma_rel, Real gamma_M, Real eps_e, Real p, Real xi, Real guess, size_t* iters)
  * DESCRIPTION: Computes the minimum electron Lorentz factor (gamma_m) for synchrotron emission based on the
- *              available energy, power-law index p, and fraction of electrons xi. Uses rootBisection for p=2.
+ *              available energy, power-law index p, and fraction of electrons xi. Closed form for p != 2. For p = 2,
+ *              x = gamma_m - 1 solves x ln(gamma_M / x) - ln x = gamma_bar - 1 + ln gamma_M; the left side rises
+ *              and is concave on the relativistic branch 1 <= x <= gamma_M / e, where rootNewton converges
+ *              monotonically after at most one step (guess: gamma_m of a neighbouring cell). Without a root on that
+ *              branch, the equation is bisected over [0, gamma_M].
  ********************************************************************************************************************/
-Real syn_gamma_m(Real Gamma_rel, Real gamma_M, Real eps_e, Real p, Real xi) {
+Real syn_gamma_m(Real Gamma_rel, Real gamma_M, Real eps_e, Real p, Real xi, Real guess, size_t* iters) {
     Real gamma_bar_minus_1 = eps_e * (Gamma_rel - 1) * (con::mp / con::me) / xi;
     Real gamma_m_minus_1 = 1;
     if (p > 2) {
@@ -480,37 +811,62 @@ Real syn_gamma_m(Real Gamma_rel, Real gamma_M, Real eps_e, Real p, Real xi) {
         // Handle non-relativistic limit when p < 2
         gamma_m_minus_1 = std::pow((2 - p) / (p - 1) * gamma_bar_minus_1 * std::pow(gamma_M, p - 2), 1 / (p - 1));
     } else {
-        gamma_m_minus_1 = rootBisection(
-            [=](Real x) -> Real {
-                return (x * std::log(gamma_M) - (x + 1) * std::log(x) - gamma_bar_minus_1 - std::log(gamma_M));
-            },
-            0, gamma_M);
+        Real log_gamma_M = std::log(gamma_M);
+        auto f = [=](Real x) {
+            Real log_x = std::log(x);
+            return std::make_pair(x * log_gamma_M - (x + 1) * log_x - gamma_bar_minus_1 - log_gamma_M,
+                                  log_gamma_M - log_x - 1 - 1 / x);
+        };
+        Real x_peak = gamma_M / std::numbers::e;
+        if (gamma_bar_minus_1 > 0 && x_peak > 1 && f(x_peak).first > 0) {
+            Real x0 = guess > 0 ? guess - 1
+                                : gamma_bar_minus_1 / std::max<Real>(std::log(x_peak / gamma_bar_minus_1), 1);
+            gamma_m_minus_1 = rootNewton(f, 1, x_peak, x0, 1e-6, iters);
+        } else {
+            gamma_m_minus_1 = rootBisection([=](Real x) -> Real { return f(x).first; }, 0, gamma_M);
+        }
     }
     return gamma_m_minus_1 + 1;
 }
 
 /********************************************************************************************************************
- * FUNCTION: syn_gamma_c(Real t_com, Real B, std::vector<InverseComptonY> const& Ys, Real p)
+ * FUNCTION: syn_gamma_c(Real t_com, Real B, InverseComptonY const& Ys, Real p, Real guess, size_t* iters)
  * DESCRIPTION: Computes the cooling electron Lorentz factor (gamma_c) based on the comoving time t_com, magnetic
- *              field B, and inverse Compton corrections. Iterates until convergence.
+ *              field B, and inverse Compton corrections: gamma_c - 1 / gamma_c = gamma_bar / (1 + Y(gamma_c)). If Y
+ *              does not depend on gamma, this is closed form. Otherwise, the self-consistent Y is found with
+ *              rootNewton on Y - Y(gamma_c(Y)), bracketed by [0, Y_max] (bisection covers the segments where the
+ *              residual is not monotonic). guess is the gamma_c of a neighbouring cell.
  ********************************************************************************************************************/
-Real syn_gamma_c(Real t_com, Real B, InverseComptonY const& Ys, Real p) {
+Real syn_gamma_c(Real t_com, Real B, InverseComptonY const& Ys, Real p, Real guess, size_t* iters) {
     // t_com = (6*pi*gamma*me*c^2) /(gamma^2*beta^2*sigma_T*c*B^2*(1 + Y_tilt))
     // Real gamma_c = 6 * con::pi * con::me * con::c / (con::sigmaT * B * B * (1 + Y_tilt) * t_com);
-
-    Real Y0 = InverseComptonY::Y_Thompson(Ys);
-    Real gamma_bar = (6 * con::pi * con::me * con::c / con::sigmaT) / (B * B * (1 + Y0) * t_com);
-    Real gamma_c = (gamma_bar + std::sqrt(gamma_bar * gamma_bar + 4)) / 2;
-    Real Y1 = InverseComptonY::Y_tilt_gamma(Ys, gamma_c, p);
-
-    for (; std::abs((Y1 - Y0) / Y0) > 1e-3;) {
-        gamma_bar = (6 * con::pi * con::me * con::c / con::sigmaT) / (B * B * (1 + Y1) * t_com);
-        gamma_c = (gamma_bar + std::sqrt(gamma_bar * gamma_bar + 4)) / 2;
-        Y0 = Y1;
-        Y1 = InverseComptonY::Y_tilt_gamma(Ys, gamma_c, p);
+    auto gamma_bar = [=](Real Y) { return (6 * con::pi * con::me * con::c / con::sigmaT) / (B * B * (1 + Y) * t_com); };
+    auto gamma_c = [=](Real Y) {
+        Real g = gamma_bar(Y);
+        return (g + std::sqrt(g * g + 4)) / 2;
+    };
+
+    Real Y_T = InverseComptonY::Y_Thompson(Ys);
+    if ((Ys.regime != 1 && Ys.regime != 2) || !std::isfinite(gamma_bar(0))) {
+        return gamma_c(Y_T);
     }
 
-    return gamma_c;
+    // Start from the Y of the guess (or of the Thomson solution), one more evaluation of Y.
+    Real Y0 = InverseComptonY::Y_tilt_gamma(Ys, guess > 0 ? guess : gamma_c(Y_T), p);
+    if (iters != nullptr) {
+        ++*iters;
+    }
+    Real Y = rootNewton(
+        [&](Real Y) {
+            Real g = gamma_bar(Y);
+            Real root = std::sqrt(g * g + 4);
+            Real gamma = (g + root) / 2;
+            Real Y_gamma = InverseComptonY::Y_tilt_gamma(Ys, gamma, p);
+            // d log gamma_c / dY = -gamma_bar / (sqrt(gamma_bar^2 + 4) (1 + Y))
+            return std::make_pair(Y - Y_gamma, 1 + Y_gamma * Ys.as_gamma_slope(gamma, p) * g / (root * (1 + Y)));
+        },
+        0, Ys.Y_max(p), Y0, 1e-6, iters);
+    return gamma_c(Y);
 }
 
 /********************************************************************************************************************
@@ -570,57 +926,97 @@ Real syn_gamma_N_peak(Real gamma_a, Real gamma_m, Real gamma_c) {
 Real syn_gamma_N_peak(SynElectrons const& e) { return syn_gamma_N_peak(e.gamma_a, e.gamma_m, e.gamma_c); }
 
 /********************************************************************************************************************
- * FUNCTION: updateElectrons4Y(SynElectronGrid& e, Shock const& shock)
+ * FUNCTION: updateElectrons4Y(SynElectronGrid& e, Shock const& shock, ThreadPool* pool, SolverStats* stats)
  * DESCRIPTION: Updates electron properties in the SynElectronGrid based on new inverse Compton Y parameter values
- *              and shock parameters.
+ *              and shock parameters. The shells are distributed over the pool; along each shell, the gamma_M and
+ *              gamma_c solvers start from the solutions of the previous cells (see shellGuess). If stats is not null,
+ *              the solver work is added to it.
  ********************************************************************************************************************/
-void updateElectrons4Y(SynElectronGrid& e, Shock const& shock) {
+void updateElectrons4Y(SynElectronGrid& e, Shock const& shock, ThreadPool* pool, SolverStats* stats) {
     auto [phi_size, theta_size, t_size] = shock.shape();
-
-    for (size_t i = 0; i < phi_size; ++i) {
-        for (size_t j = 0; j < theta_size; ++j) {
+    auto Gamma_rel_ = view(shock.Gamma_rel);
+    auto t_com_ = view(shock.t_com);
+    auto B_ = view(shock.B);
+    auto e_ = view(e);
+
+    PerThread<SolverStats> solver_stats(pool);
+
+    parallelForShells(
+        pool, phi_size, theta_size,
+        [&](size_t i, size_t j) {
+            SolverStats& work = solver_stats.local();
+            Real gamma_M_prev[2] = {0, 0};  // Solutions at k-1 and k-2
+            Real gamma_c_prev[2] = {0, 0};
             for (size_t k = 0; k < t_size; ++k) {
-                Real Gamma_rel = shock.Gamma_rel[i][j][k];
-                Real t_com = shock.t_com[i][j][k];
-                Real B = shock.B[i][j][k];
-                Real p = e[i][j][k].p;
-                auto& Ys = e[i][j][k].Ys;
-                auto& electron = e[i][j][k];
-
-                electron.gamma_M = syn_gamma_M(B, Ys, p);         // Update maximum electron Lorentz factor
-                electron.gamma_c = syn_gamma_c(t_com, B, Ys, p);  // Update cooling electron Lorentz factor
+                Real Gamma_rel = Gamma_rel_(i, j, k);
+                Real t_com = t_com_(i, j, k);
+                Real B = B_(i, j, k);
+                auto& electron = e_(i, j, k);
+                Real p = electron.p;
+                auto& Ys = electron.Ys;
+
+                // Update maximum and cooling electron Lorentz factors
+                Real gamma_M_guess = shellGuess(gamma_M_prev[0], gamma_M_prev[1]);
+                Real gamma_c_guess = shellGuess(gamma_c_prev[0], gamma_c_prev[1]);
+                electron.gamma_M = syn_gamma_M(B, Ys, p, gamma_M_guess, &work.gamma_M);
+                electron.gamma_c = syn_gamma_c(t_com, B, Ys, p, gamma_c_guess, &work.gamma_c);
                 electron.gamma_a = syn_gamma_a(Gamma_rel, B, electron.I_nu_peak, electron.gamma_m, electron.gamma_c);
                 electron.regime = getRegime(electron.gamma_a, electron.gamma_c, electron.gamma_m);
                 electron.Y_c = InverseComptonY::Y_tilt_gamma(Ys, electron.gamma_c, p);
+                gamma_M_prev[1] = std::exchange(gamma_M_prev[0], electron.gamma_M);
+                gamma_c_prev[1] = std::exchange(gamma_c_prev[0], electron.gamma_c);
             }
-        }
+            work.cells += t_size;
+        },
+        {Schedule::Dynamic});  // The gamma_M/gamma_c solvers make the shell cost uneven.
+
+    if (stats != nullptr) {
+        solver_stats.forEach([stats](SolverStats const& work) { *stats += work; });
     }
 }
 
 /********************************************************************************************************************
- * FUNCTION: genSynElectrons(Shock const& shock, Real p, Real xi)
+ * FUNCTION: genSynElectrons(Shock const& shock, Real p, Real xi, ThreadPool* pool, SolverStats* stats)
  * DESCRIPTION: Generates a SynElectronGrid based on the shock parameters, power-law index p, and electron
- *              partition factor xi.
+ *              partition factor xi. The shells are distributed statically over the pool, so each thread writes the
+ *              shells it first touched; along each shell, the solvers start from the solutions of the previous cells
+ *              (see shellGuess). If stats is not null, the solver work is
+ *              added to it.
  ********************************************************************************************************************/
-SynElectronGrid genSynElectrons(Shock const& shock, Real p, Real xi) {
+SynElectronGrid genSynElectrons(Shock const& shock, Real p, Real xi, ThreadPool* pool, SolverStats* stats) {
     auto [phi_size, theta_size, t_size] = shock.shape();
 
-    SynElectronGrid electrons = createSynElectronGrid(phi_size, theta_size, t_size);
+    SynElectronGrid electrons = createSynElectronGrid(phi_size, theta_size, t_size, pool);
+    auto Gamma_rel_ = view(shock.Gamma_rel);
+    auto t_com_ = view(shock.t_com);
+    auto B_ = view(shock.B);
+    auto Sigma_ = view(shock.column_num_den);
+    auto e_ = view(electrons);
 
     constexpr Real gamma_syn_limit = 3;
 
-    for (size_t i = 0; i < phi_size; ++i) {
-        for (size_t j = 0; j < theta_size; ++j) {
-            for (size_t k = 0; k < t_size; ++k) {
-                Real Gamma_rel = shock.Gamma_rel[i][j][k];
-                Real t_com = shock.t_com[i][j][k];
-                Real B = shock.B[i][j][k];
-                Real Sigma = shock.column_num_den[i][j][k];
-
-                auto& e = electrons[i][j][k];
+    PerThread<SolverStats> solver_stats(pool);
 
-                e.gamma_M = syn_gamma_M(B, electrons[i][j][k].Ys, p);
-                e.gamma_m = syn_gamma_m(Gamma_rel, e.gamma_M, shock.eps_e, p, xi);
+    parallelForShells(
+        pool, phi_size, theta_size,
+        [&](size_t i, size_t j) {
+            SolverStats& work = solver_stats.local();
+            Real gamma_M_prev[2] = {0, 0};  // Solutions at k-1 and k-2
+            Real gamma_m_prev[2] = {0, 0};
+            Real gamma_c_prev[2] = {0, 0};
+            for (size_t k = 0; k < t_size; ++k) {
+                Real Gamma_rel = Gamma_rel_(i, j, k);
+                Real t_com = t_com_(i, j, k);
+                Real B = B_(i, j, k);
+                Real Sigma = Sigma_(i, j, k);
+
+                auto& e = e_(i, j, k);
+
+                e.gamma_M = syn_gamma_M(B, e.Ys, p, shellGuess(gamma_M_prev[0], gamma_M_prev[1]), &work.gamma_M);
+                e.gamma_m = syn_gamma_m(Gamma_rel, e.gamma_M, shock.eps_e, p, xi,
+                                        shellGuess(gamma_m_prev[0], gamma_m_prev[1]), &work.gamma_m);
+                gamma_M_prev[1] = std::exchange(gamma_M_prev[0], e.gamma_M);
+                gamma_m_prev[1] = std::exchange(gamma_m_prev[0], e.gamma_m);
                 // Fraction of synchrotron electrons; the rest are cyclotron
                 Real f = 1.;
                 if (1 < e.gamma_m && e.gamma_m < gamma_syn_limit) {
@@ -629,40 +1025,51 @@ SynElectronGrid genSynElectrons(Shock const& shock, Real p, Real xi) {
                 }
                 e.column_num_den = Sigma * f;
                 e.I_nu_peak = syn_p_nu_peak(B, p) * e.column_num_den / (4 * con::pi);
-                e.gamma_c = syn_gamma_c(t_com, B, electrons[i][j][k].Ys, p);
+                e.gamma_c = syn_gamma_c(t_com, B, e.Ys, p, shellGuess(gamma_c_prev[0], gamma_c_prev[1]), &work.gamma_c);
                 e.gamma_a = syn_gamma_a(Gamma_rel, B, e.I_nu_peak, e.gamma_m, e.gamma_c);
                 e.regime = getRegime(e.gamma_a, e.gamma_c, e.gamma_m);
                 e.p = p;
+                gamma_c_prev[1] = std::exchange(gamma_c_prev[0], e.gamma_c);
             }
-        }
+            work.cells += t_size;
+        });  // Static: the warm-started solvers take about the same work per shell, and the grids were first
+             // touched with the same shell partition (see createCellGrid).
+
+    if (stats != nullptr) {
+        solver_stats.forEach([stats](SolverStats const& work) { *stats += work; });
     }
     return electrons;
 }
 
 /********************************************************************************************************************
- * FUNCTION: genSynPhotons(Shock const& shock, SynElectronGrid const& e)
+ * FUNCTION: genSynPhotons(Shock const& shock, SynElectronGrid const& e, ThreadPool* pool)
  * DESCRIPTION: Generates a SynPhotonGrid based on the shock parameters and the precomputed SynElectronGrid.
  *              For each grid cell, synchrotron photon frequencies are computed and internal constants are updated.
  ********************************************************************************************************************/
-SynPhotonGrid genSynPhotons(Shock const& shock, SynElectronGrid const& e) {
+SynPhotonGrid genSynPhotons(Shock const& shock, SynElectronGrid const& e, ThreadPool* pool) {
     auto [phi_size, theta_size, t_size] = shock.shape();
 
-    SynPhotonGrid ph = createSynPhotonGrid(phi_size, theta_size, t_size);
-
-    for (size_t i = 0; i < phi_size; ++i) {
-        for (size_t j = 0; j < theta_size; ++j) {
-            for (size_t k = 0; k < t_size; ++k) {
-                ph[i][j][k].e = &(e[i][j][k]);
-                Real B = shock.B[i][j][k];
-
-                ph[i][j][k].nu_M = syn_nu(e[i][j][k].gamma_M, B);
-                ph[i][j][k].nu_m = syn_nu(e[i][j][k].gamma_m, B);
-                ph[i][j][k].nu_c = syn_nu(e[i][j][k].gamma_c, B);
-                ph[i][j][k].nu_a = syn_nu(e[i][j][k].gamma_a, B);
-
-                ph[i][j][k].updateConstant();
-            }
-        }
-    }
+    SynPhotonGrid ph(phi_size, theta_size, t_size, pool);
+    auto B_ = view(shock.B);
+    auto e_ = view(e);
+
+    parallelForCells(pool, phi_size, theta_size, t_size, [&](size_t i, size_t j, size_t k) {
+        auto const& e_ijk = e_(i, j, k);
+        Real B = B_(i, j, k);
+
+        SynPhotons cell;
+        cell.nu_M = syn_nu(e_ijk.gamma_M, B);
+        cell.nu_m = syn_nu(e_ijk.gamma_m, B);
+        cell.nu_c = syn_nu(e_ijk.gamma_c, B);
+        cell.nu_a = syn_nu(e_ijk.gamma_a, B);
+        cell.I_nu_peak = e_ijk.I_nu_peak;
+        cell.p = e_ijk.p;
+        cell.Y_c = e_ijk.Y_c;
+        cell.regime = e_ijk.regime;
+        cell.Ys = e_ijk.Ys;
+        cell.updateConstant();
+
+        ph.set(i, j, k, cell);
+    });
     return ph;
 }
@@ -97,7 +97,7 @@ void writeGrid(std::string filename, T const& names, U const& data, V const& uni
  ********************************************************************************************************************/
 void output(Shock const& shock, std::string const& filename) {
     std::array<std::string, 5> strs = {"Gamma", "B", "t_com", "r", "Sigma"};
-    std::array<MeshGrid3d const*, 5> data = {&(shock.Gamma_rel), &(shock.B), &(shock.t_com), &(shock.r),
+    std::array<ShockField const*, 5> data = {&(shock.Gamma_rel), &(shock.B), &(shock.t_com), &(shock.r),
                                              &(shock.column_num_den)};
     std::array<Real, 5> units = {1, 1, con::sec, con::cm, 1 / con::cm2};
 
@@ -125,12 +125,13 @@ void output(SynPhotonGrid const& ph, std::string const& filename) {
         }
     }
 
-    for (size_t i = 0; i < ph.size(); ++i) {
-        for (size_t j = 0; j < ph[i].size(); ++j) {
-            for (size_t k = 0; k < ph[i][j].size(); ++k) {
-                files[0] << ph[i][j][k].nu_a / con::Hz << " ";
-                files[1] << ph[i][j][k].nu_m / con::Hz << " ";
-                files[2] << ph[i][j][k].nu_c / con::Hz << " ";
+    auto [phi_size, theta_size, t_size] = ph.shape();
+    for (size_t i = 0; i < phi_size; ++i) {
+        for (size_t j = 0; j < theta_size; ++j) {
+            for (size_t k = 0; k < t_size; ++k) {
+                files[0] << ph.nu_a[i][j][k] / con::Hz << " ";
+                files[1] << ph.nu_m[i][j][k] / con::Hz << " ";
+                files[2] << ph.nu_c[i][j][k] / con::Hz << " ";
             }
             files[0] << '\n';
             files[1] << '\n';
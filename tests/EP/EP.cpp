@@ -47,10 +47,12 @@ void GCN36236(Real theta_c) {
 
     for (size_t i = 0; i < 1; i++) {
         Array band_pass = logspace(lo[i], hi[i], 5);
-        for (auto theta_v : theta_obs) {
-            obs.changeViewingAngle(theta_v);
 
-            auto to_suffix = [](Real theta) { return std::to_string(int((theta / con::deg))); };
+        // All viewing angles in one pass: F_syn[angle][t].
+        MeshGrid F_syn = obs.fluxVsAngle(theta_obs, t_bins, band_pass, syn_ph);
+
+        for (size_t a = 0; a < theta_obs.size(); ++a) {
+            Real theta_v = theta_obs[a];
 
             char buff[100] = {0};
 
@@ -60,9 +62,7 @@ void GCN36236(Real theta_c) {
 
             std::cout << fname << std::endl;
 
-            Array F_syn = obs.flux(t_bins, band_pass, syn_ph);
-
-            output(F_syn, fname, con::erg / con::sec / con::cm / con::cm);
+            output(Array(F_syn[a]), fname, con::erg / con::sec / con::cm / con::cm);
         }
     }
     output(t_bins, "data/t_obs", con::sec);
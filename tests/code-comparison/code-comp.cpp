@@ -71,7 +71,8 @@ void lc_gen(std::string folder_name) {
 
     Observer obs(coord, f_shock, theta_view, lumi_dist, z);
 
-    Array band_pass = logspace(eVtoHz(band_pass_[0] * con::keV), eVtoHz(band_pass_[1] * con::keV), 50);
+    Real nu_lo = eVtoHz(band_pass_[0] * con::keV);
+    Real nu_hi = eVtoHz(band_pass_[1] * con::keV);
 
     namespace fs = std::filesystem;
 
@@ -82,12 +83,12 @@ void lc_gen(std::string folder_name) {
     std::ofstream file(working_dir + "/flux.csv");
 
     if (ic_cool) {
-        Array F_nu_syn = obs.flux(t_bins, band_pass, syn_ph);
+        Array F_nu_syn = obs.bandFlux(t_bins, nu_lo, nu_hi, syn_ph);
         for (size_t i = 0; i < t_bins.size(); ++i) {
             file << t_bins[i] / con::sec << ',' << F_nu_syn[i] / (con::erg / con::cm / con::cm / con::sec) << '\n';
         }
     } else {
-        Array F_nu_syn_no_cool = obs.flux(t_bins, band_pass, syn_ph);
+        Array F_nu_syn_no_cool = obs.bandFlux(t_bins, nu_lo, nu_hi, syn_ph);
         for (size_t i = 0; i < t_bins.size(); ++i) {
             file << t_bins[i] / con::sec << ',' << F_nu_syn_no_cool[i] / (con::erg / con::cm / con::cm / con::sec)
                  << '\n';
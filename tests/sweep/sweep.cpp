@@ -0,0 +1,363 @@
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+
+#include "afterglow.h"
+
+/********************************************************************************************************************
+ * Parameter sweep driver.
+ *
+ *   sweep <params.csv> <out_dir> [-n workers] [-t threads] [-s shards] [-r retries]
+ *   sweep <params.csv> <out_dir> --shard <id> -s shards [-t threads]
+ *
+ * params.csv has a header line naming the columns (any order):
+ *   jet (tophat | gaussian), E_iso [erg], Gamma0, theta_c, theta_w, theta_v, n_ism [cm^-3], eps_e, eps_B, p,
+ *   lumi_dist [cm], z, nu [Hz]
+ * and one model per line. The table is cut into shards of consecutive models; up to `workers` shards run at a time,
+ * each in its own process with a pool of `threads` threads. A finished shard leaves
+ * out_dir/shard_<id>_of_<shards>_models_<begin>-<end>_<hash>.csv (written to a temporary file and renamed, so the
+ * file only exists if the shard completed), where <hash> is a hash of the shard's model parameters. Shards that fail
+ * are rerun up to `retries` times; rerunning the sweep skips every shard that already has its file. Since the file
+ * name carries the shard count, the model range and the parameter hash, a rerun with a different -n/-s, a different
+ * table length or edited rows never picks up stale shards. Once all shards are done, they are merged
+ * in model order into out_dir/light_curves.csv, checking that every model index appears exactly once and in order:
+ * the first line holds the observer times [s], then one line per model with the model index and the specific flux
+ * [erg/cm^2/s/Hz].
+ *
+ * `--shard <id>` runs a single shard in the current process (e.g., to distribute shards over several machines). It
+ * requires an explicit -s, since the default shard count depends on the machine.
+ ********************************************************************************************************************/
+
+struct Model {
+    std::string jet{"tophat"};
+    Real E_iso{0};
+    Real Gamma0{0};
+    Real theta_c{0};
+    Real theta_w{0};
+    Real theta_v{0};
+    Real n_ism{0};
+    Real eps_e{0};
+    Real eps_B{0};
+    Real p{0};
+    Real lumi_dist{0};
+    Real z{0};
+    Real nu{0};
+};
+
+// Observer times of every light curve.
+Array const t_obs = logspace(1e2 * con::sec, 1e8 * con::sec, 100);
+
+std::vector<std::string> splitCSV(std::string const& line) {
+    std::vector<std::string> fields;
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, ',')) {
+        field.erase(0, field.find_first_not_of(" \t\r"));
+        field.erase(field.find_last_not_of(" \t\r") + 1);
+        fields.push_back(field);
+    }
+    return fields;
+}
+
+std::vector<Model> readTable(std::string const& filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        throw std::runtime_error("Cannot open parameter table " + filename);
+    }
+    std::string line;
+    std::getline(file, line);
+    std::vector<std::string> header = splitCSV(line);
+
+    std::vector<Model> models;
+    while (std::getline(file, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        std::vector<std::string> fields = splitCSV(line);
+        if (fields.size() != header.size()) {
+            throw std::runtime_error("Wrong number of columns in line: " + line);
+        }
+        std::map<std::string, std::string> row;
+        for (size_t c = 0; c < header.size(); ++c) {
+            row[header[c]] = fields[c];
+        }
+        auto get = [&](std::string const& key) {
+            if (row.count(key) == 0) {
+                throw std::runtime_error("Missing column " + key);
+            }
+            return std::stod(row[key]);
+        };
+
+        Model m;
+        if (row.count("jet") != 0) {
+            m.jet = row["jet"];
+        }
+        m.E_iso = get("E_iso") * con::erg;
+        m.Gamma0 = get("Gamma0");
+        m.theta_c = get("theta_c");
+        m.theta_w = get("theta_w");
+        m.theta_v = get("theta_v");
+        m.n_ism = get("n_ism") / con::cm3;
+        m.eps_e = get("eps_e");
+        m.eps_B = get("eps_B");
+        m.p = get("p");
+        m.lumi_dist = get("lumi_dist") * con::cm;
+        m.z = get("z");
+        m.nu = get("nu") * con::Hz;
+        models.push_back(m);
+    }
+    return models;
+}
+
+template <typename Jet>
+Array lightCurve(Model const& m, Jet const& jet, ThreadPool* pool) {
+    auto medium = createISM(m.n_ism);
+    Coord coord = adaptiveGrid(medium, jet, inject::none, t_obs, m.theta_w);
+    Shock f_shock = genForwardShock(coord, medium, jet, inject::none, m.eps_e, m.eps_B, 1e-6, pool);
+    auto syn_e = genSynElectrons(f_shock, m.p, 1, pool);
+    auto syn_ph = genSynPhotons(f_shock, syn_e, pool);
+    Observer obs(coord, f_shock, m.theta_v, m.lumi_dist, m.z, pool);
+    return obs.specificFlux(t_obs, m.nu, syn_ph);
+}
+
+Array lightCurve(Model const& m, ThreadPool* pool) {
+    if (m.jet == "tophat") {
+        return lightCurve(m, TophatJet(m.theta_c, m.E_iso, m.Gamma0), pool);
+    } else if (m.jet == "gaussian") {
+        return lightCurve(m, GaussianJet(m.theta_c, m.E_iso, m.Gamma0), pool);
+    } else {
+        throw std::runtime_error("Jet type not recognized: " + m.jet);
+    }
+}
+
+// Models [begin, end) of a shard.
+std::pair<size_t, size_t> shardRange(size_t model_num, size_t shard, size_t shard_num) {
+    return {shard * model_num / shard_num, (shard + 1) * model_num / shard_num};
+}
+
+// 64-bit FNV-1a hash of the parameters of models [begin, end), as 16 hex digits.
+std::string modelHash(std::vector<Model> const& models, size_t begin, size_t end) {
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](void const* data, size_t size) {
+        auto bytes = static_cast<unsigned char const*>(data);
+        for (size_t b = 0; b < size; ++b) {
+            hash = (hash ^ bytes[b]) * 1099511628211ull;
+        }
+    };
+    for (size_t m = begin; m < end; ++m) {
+        Model const& model = models[m];
+        add(model.jet.data(), model.jet.size() + 1);
+        for (Real v : {model.E_iso, model.Gamma0, model.theta_c, model.theta_w, model.theta_v, model.n_ism, model.eps_e,
+                       model.eps_B, model.p, model.lumi_dist, model.z, model.nu}) {
+            add(&v, sizeof(v));
+        }
+    }
+    std::ostringstream hex;
+    hex << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return hex.str();
+}
+
+std::string shardFile(std::string const& out_dir, std::vector<Model> const& models, size_t shard, size_t shard_num) {
+    auto [begin, end] = shardRange(models.size(), shard, shard_num);
+    return out_dir + "/shard_" + std::to_string(shard) + "_of_" + std::to_string(shard_num) + "_models_" +
+           std::to_string(begin) + "-" + std::to_string(end) + "_" + modelHash(models, begin, end) + ".csv";
+}
+
+// Computes the models of one shard and writes them to its shard file. Returns the process exit code.
+int runShard(std::vector<Model> const& models, size_t shard, size_t shard_num, std::string const& out_dir,
+             size_t threads) {
+    std::string file_name = shardFile(out_dir, models, shard, shard_num);
+    std::string tmp = file_name + ".tmp";
+    try {
+        auto [begin, end] = shardRange(models.size(), shard, shard_num);
+
+        ThreadPool pool(threads);
+        std::ofstream file(tmp);
+        file.precision(16);
+        for (size_t m = begin; m < end; ++m) {
+            Array F_nu = lightCurve(models[m], &pool);
+            file << m;
+            for (size_t k = 0; k < F_nu.size(); ++k) {
+                file << ',' << F_nu[k] / (con::erg / con::cm2 / con::sec / con::Hz);
+            }
+            file << '\n';
+        }
+        file.close();
+        if (!file) {
+            throw std::runtime_error("Failed to write " + tmp);
+        }
+        std::filesystem::rename(tmp, file_name);  // The shard only counts as done once renamed.
+        return 0;
+    } catch (std::exception const& e) {
+        std::cerr << "shard " << shard << ": " << e.what() << std::endl;
+        std::filesystem::remove(tmp);
+        return 1;
+    }
+}
+
+// Merges all shard files, in model order, into out_dir/light_curves.csv. Throws if the shard file for the current
+// parameters of a shard is missing (shards computed from other rows have another hash in their name) or does not hold
+// exactly its own models; the merged file is then removed rather than left half written.
+void mergeShards(std::string const& out_dir, std::vector<Model> const& models, size_t shard_num) {
+    std::string merged = out_dir + "/light_curves.csv";
+    try {
+        std::ofstream out(merged);
+        out.precision(16);
+        out << "t_obs";
+        for (size_t k = 0; k < t_obs.size(); ++k) {
+            out << ',' << t_obs[k] / con::sec;
+        }
+        out << '\n';
+        for (size_t s = 0; s < shard_num; ++s) {
+            std::string file_name = shardFile(out_dir, models, s, shard_num);
+            std::ifstream in(file_name);
+            if (!in) {
+                throw std::runtime_error("Cannot open " + file_name + " (not run for the current parameters)");
+            }
+            auto [begin, end] = shardRange(models.size(), s, shard_num);
+            size_t m = begin;
+            std::string line;
+            while (std::getline(in, line)) {
+                std::string index = line.substr(0, line.find(','));
+                if (m == end || index != std::to_string(m)) {
+                    throw std::runtime_error(file_name + ": unexpected model index " + index);
+                }
+                out << line << '\n';
+                m++;
+            }
+            if (m != end) {
+                throw std::runtime_error(file_name + ": missing models " + std::to_string(m) + "-" +
+                                         std::to_string(end - 1));
+            }
+        }
+        out.close();
+        if (!out) {
+            throw std::runtime_error("Failed to write " + merged);
+        }
+    } catch (...) {
+        std::filesystem::remove(merged);
+        throw;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0]
+                  << " <params.csv> <out_dir> [-n workers] [-t threads] [-s shards] [-r retries] [--shard id]\n";
+        return 1;
+    }
+    std::string table = argv[1];
+    std::string out_dir = argv[2];
+    size_t workers = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    size_t threads = 1;
+    size_t shard_num = 0;
+    size_t retries = 2;
+    long single_shard = -1;
+    for (int a = 3; a + 1 < argc; a += 2) {
+        std::string opt = argv[a];
+        size_t val = std::stoul(argv[a + 1]);
+        if (opt == "-n") {
+            workers = std::max<size_t>(val, 1);
+        } else if (opt == "-t") {
+            threads = std::max<size_t>(val, 1);
+        } else if (opt == "-s") {
+            shard_num = val;
+        } else if (opt == "-r") {
+            retries = val;
+        } else if (opt == "--shard") {
+            single_shard = static_cast<long>(val);
+        } else {
+            std::cerr << "unknown option " << opt << '\n';
+            return 1;
+        }
+    }
+
+    if (single_shard >= 0 && shard_num == 0) {
+        std::cerr << "--shard requires -s, so that every machine cuts the table the same way\n";
+        return 1;
+    }
+
+    std::vector<Model> models = readTable(table);
+    if (shard_num == 0) {
+        shard_num = 4 * workers;  // Small shards keep retries cheap and the workers busy.
+    }
+    shard_num = std::max<size_t>(std::min(shard_num, models.size()), 1);
+    std::filesystem::create_directories(out_dir);
+
+    if (single_shard >= 0) {
+        if (static_cast<size_t>(single_shard) >= shard_num) {
+            std::cerr << "shard " << single_shard << " out of range: " << shard_num << " shards\n";
+            return 1;
+        }
+        return runShard(models, single_shard, shard_num, out_dir, threads);
+    }
+
+    std::vector<size_t> pending;
+    for (size_t s = 0; s < shard_num; ++s) {
+        if (!std::filesystem::exists(shardFile(out_dir, models, s, shard_num))) {
+            pending.push_back(s);
+        }
+    }
+    std::cout << models.size() << " models, " << shard_num << " shards, " << shard_num - pending.size()
+              << " already done\n";
+
+    // Run the pending shards in child processes, at most `workers` at a time, retrying failed ones.
+    std::vector<size_t> attempts(shard_num, 0);
+    std::map<pid_t, size_t> running;
+    std::vector<size_t> failed;
+    while (!pending.empty() || !running.empty()) {
+        while (!pending.empty() && running.size() < workers) {
+            size_t s = pending.back();
+            pending.pop_back();
+            attempts[s]++;
+            std::cout.flush();
+            pid_t pid = fork();
+            if (pid == 0) {
+                _exit(runShard(models, s, shard_num, out_dir, threads));
+            } else if (pid < 0) {
+                std::cerr << "fork failed\n";
+                return 1;
+            }
+            running[pid] = s;
+        }
+
+        int status = 0;
+        pid_t pid = wait(&status);
+        if (pid < 0) {
+            std::cerr << "wait failed with " << running.size() << " shards still running\n";
+            return 1;
+        }
+        size_t s = running[pid];
+        running.erase(pid);
+        bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+                  std::filesystem::exists(shardFile(out_dir, models, s, shard_num));
+        if (ok) {
+            std::cout << "shard " << s << " done\n";
+        } else if (attempts[s] <= retries) {
+            std::cout << "shard " << s << " failed, retrying\n";
+            pending.push_back(s);
+        } else {
+            std::cout << "shard " << s << " failed " << attempts[s] << " times, giving up\n";
+            failed.push_back(s);
+        }
+    }
+
+    if (!failed.empty()) {
+        std::cerr << failed.size() << " shards failed; rerun to retry them (finished shards are kept)\n";
+        return 1;
+    }
+    try {
+        mergeShards(out_dir, models, shard_num);
+    } catch (std::exception const& e) {
+        std::cerr << "merge failed: " << e.what() << '\n';
+        return 1;
+    }
+    std::cout << "merged into " << out_dir << "/light_curves.csv\n";
+    return 0;
+}